@@ -0,0 +1,25 @@
+# Writes OUTPUT, a header defining LUMI_GIT_REVISION as the short hash of SOURCE_DIR's HEAD, with a -dirty
+# suffix for uncommitted changes. Run on every build; the header only changes when the revision does.
+execute_process(
+    COMMAND git rev-parse --short=12 HEAD
+    WORKING_DIRECTORY ${SOURCE_DIR}
+    OUTPUT_VARIABLE revision
+    OUTPUT_STRIP_TRAILING_WHITESPACE
+    RESULT_VARIABLE result
+    ERROR_QUIET)
+if(NOT result EQUAL 0)
+    set(revision unknown)
+else()
+    execute_process(
+        COMMAND git status --porcelain --untracked-files=no
+        WORKING_DIRECTORY ${SOURCE_DIR}
+        OUTPUT_VARIABLE changes
+        ERROR_QUIET)
+    if(changes)
+        set(revision "${revision}-dirty")
+    endif()
+endif()
+
+file(WRITE ${OUTPUT}.tmp "#pragma once\n#define LUMI_GIT_REVISION \"${revision}\"\n")
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different ${OUTPUT}.tmp ${OUTPUT})
+file(REMOVE ${OUTPUT}.tmp)
@@ -0,0 +1,300 @@
+#include "render/geometry/objects/sphere.h"
+#include "render/geometry/objects/quad.h"
+#include "render/geometry/hittable/hittable_list.h"
+#include "render/geometry/bounding/bvh.h"
+#include "render/geometry/objects/primitive_arrays.h"
+#include "render/geometry/bounding/linear_bvh.h"
+#include "render/parallel/thread_pool.h"
+#include "render/material/material.h"
+#include "render/pdf.h"
+#include "render/camera/camera.h"
+#include "render/init/world.h"
+#include "bench/microbench.h"
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Microbenchmarks of the intersection and sampling kernels, each run on fixed coherent and incoherent
+// ray sets so changes to one kernel can be measured in isolation from whole frame times.
+namespace
+{
+  using Microbench::doNotOptimize;
+
+  const size_t RAY_COUNT = 4096;
+  const unsigned int PATH_IMAGE_SIZE = 32; // Edge of the image the path benchmark renders
+
+  // Camera-like rays: one origin, directions through a regular grid covering the target, row by row.
+  std::vector<Ray> coherentRays(const glm::vec3 &eye, const glm::vec3 &target, float halfExtent)
+  {
+    glm::vec3 w = glm::normalize(eye - target);
+    glm::vec3 u = glm::normalize(glm::cross(glm::vec3(0, 1, 0), w));
+    glm::vec3 v = glm::cross(w, u);
+    size_t side = static_cast<size_t>(std::sqrt(static_cast<double>(RAY_COUNT)));
+
+    std::vector<Ray> rays;
+    for (size_t y = 0; y < side; y++)
+    {
+      for (size_t x = 0; x < side; x++)
+      {
+        float s = (2.0f * (x + 0.5f) / side - 1.0f) * halfExtent;
+        float t = (2.0f * (y + 0.5f) / side - 1.0f) * halfExtent;
+        rays.emplace_back(eye, target + s * u + t * v - eye);
+      }
+    }
+    return rays;
+  }
+
+  // Secondary-bounce-like rays: uniform origins inside a box, uniform directions.
+  std::vector<Ray> incoherentRays(const glm::vec3 &center, float halfExtent)
+  {
+    Utils::Random::RNG rng(1, 0);
+    std::vector<Ray> rays;
+    for (size_t i = 0; i < RAY_COUNT; i++)
+    {
+      glm::vec3 origin = center + halfExtent * glm::vec3(2 * rng.nextFloat() - 1, 2 * rng.nextFloat() - 1, 2 * rng.nextFloat() - 1);
+      rays.emplace_back(origin, Utils::Sampling::sampleUnitSphere(rng));
+    }
+    return rays;
+  }
+
+  // Registers name/coherent and name/incoherent, intersecting every ray of the set with object per iteration.
+  // Hit tests must not allocate.
+  template <typename Intersect>
+  void addRayBenchmarks(std::vector<Microbench::Benchmark> &benchmarks, const std::string &name,
+                        const std::vector<Ray> &coherent, const std::vector<Ray> &incoherent, Intersect intersect)
+  {
+    for (const auto &[kind, rays] : {std::pair{"coherent", &coherent}, std::pair{"incoherent", &incoherent}})
+    {
+      benchmarks.push_back({name + "/" + kind, rays->size(), [rays, intersect](size_t iterations)
+                            {
+                              for (size_t i = 0; i < iterations; i++)
+                              {
+                                for (const Ray &r : *rays)
+                                  doNotOptimize(intersect(r));
+                              }
+                            }, 0});
+    }
+  }
+
+  // Ground sphere plus a jittered grid of small spheres, like the 400 sphere scene.
+  HittableList sphereField()
+  {
+    Utils::Random::RNG rng(2, 0);
+    const uint32_t material = 0;
+    HittableList field;
+    field.add(std::make_shared<Sphere>(glm::vec3(0, -1000, 0), 1000, material));
+    for (int a = -11; a < 11; a++)
+    {
+      for (int b = -11; b < 11; b++)
+        field.add(std::make_shared<Sphere>(glm::vec3(a + 0.9f * rng.nextFloat(), 0.2f, b + 0.9f * rng.nextFloat()), 0.2f, material));
+    }
+    return field;
+  }
+
+  // Builds the same bounds serially and on a thread pool with every split method. Parallel builds promise the
+  // exact nodes and primitive order of a serial build, so one can stand in for the other in regression tests.
+  bool parallelBuildsMatchSerial()
+  {
+    // Well above BVHBuildOptions::parallelThreshold, with a run of identical boxes to exercise tie breaking
+    Utils::Random::RNG rng(3, 0);
+    std::vector<AABB> bounds;
+    for (int i = 0; i < 100000; i++)
+    {
+      glm::vec3 min = 100.0f * glm::vec3(rng.nextFloat(), rng.nextFloat(), rng.nextFloat());
+      bounds.emplace_back(min, min + glm::vec3(rng.nextFloat(), rng.nextFloat(), rng.nextFloat()));
+    }
+    bounds.insert(bounds.end(), 20000, AABB(glm::vec3(50), glm::vec3(51)));
+
+    ThreadPool pool(4);
+    bool match = true;
+    for (const auto &[name, method] : {std::pair{"SAH", BVHSplitMethod::SAH}, std::pair{"Median", BVHSplitMethod::Median},
+                                       std::pair{"LBVH", BVHSplitMethod::LBVH}})
+    {
+      BVHBuildOptions serialOptions;
+      serialOptions.splitMethod = method;
+      BVHBuildOptions parallelOptions = serialOptions;
+      parallelOptions.pool = &pool;
+      LinearBVH serial(bounds, serialOptions);
+      LinearBVH parallel(bounds, parallelOptions);
+
+      bool same = serial.primitiveIndices == parallel.primitiveIndices && serial.nodes.size() == parallel.nodes.size() &&
+                  std::memcmp(serial.nodes.data(), parallel.nodes.data(), serial.nodes.size() * sizeof(LinearBVHNode)) == 0;
+      if (!same)
+      {
+        std::cerr << "Parallel " << name << " BVH build differs from the serial build\n";
+        match = false;
+      }
+    }
+    return match;
+  }
+
+  void printUsage()
+  {
+    std::cerr << "Usage: lumi_microbench [--filter TEXT] [--min-time SECONDS] [--repetitions N]\n";
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  Microbench::Options options;
+  for (int i = 1; i < argc; i++)
+  {
+    std::string_view option(argv[i]);
+    if (option == "--filter" && i + 1 < argc)
+      options.filter = argv[++i];
+    else if (option == "--min-time" && i + 1 < argc)
+      options.minSeconds = std::stod(argv[++i]);
+    else if (option == "--repetitions" && i + 1 < argc)
+      options.repetitions = std::stoi(argv[++i]);
+    else
+    {
+      printUsage();
+      return option == "--help" ? 0 : 1;
+    }
+  }
+
+  if (!parallelBuildsMatchSerial())
+    return 1;
+  std::cout << "Parallel BVH builds (SAH, Median, LBVH) match serial builds\n";
+
+  const uint32_t material = 0; // Hit tests only copy the index, no material table is needed
+  std::vector<Microbench::Benchmark> benchmarks;
+
+  // Unit sized primitives at the origin, coherent rays come from a camera in front of them
+  std::vector<Ray> coherent = coherentRays(glm::vec3(0, 0, 5), glm::vec3(0), 1.5f);
+  std::vector<Ray> incoherent = incoherentRays(glm::vec3(0), 3.0f);
+
+  Sphere sphere(glm::vec3(0), 1.0f, material);
+  addRayBenchmarks(benchmarks, "Sphere::hit", coherent, incoherent, [&sphere](const Ray &r)
+  {
+    HitRecord rec;
+    return sphere.hit(r, Interval(0.001f, INFINITY), rec);
+  });
+
+  Quad quad(glm::vec3(-1, -1, 0), glm::vec3(2, 0, 0), glm::vec3(0, 2, 0), material);
+  addRayBenchmarks(benchmarks, "Quad::hit", coherent, incoherent, [&quad](const Ray &r)
+  {
+    HitRecord rec;
+    return quad.hit(r, Interval(0.001f, INFINITY), rec);
+  });
+
+  AABB box(glm::vec3(-1), glm::vec3(1));
+  addRayBenchmarks(benchmarks, "AABB::hit", coherent, incoherent, [&box](const Ray &r)
+  {
+    return box.hit(r, Interval(0.001f, INFINITY));
+  });
+
+  // The same ~500 spheres brute force, as virtual calls and compiled into sphere arrays, and behind a BVH.
+  // Rays cover the small spheres
+  HittableList field = sphereField();
+  BVHNode bvh(field);
+  std::vector<Ray> fieldCoherent = coherentRays(glm::vec3(13, 2, 3), glm::vec3(0), 4.0f);
+  std::vector<Ray> fieldIncoherent = incoherentRays(glm::vec3(0, 1, 0), 11.0f);
+  addRayBenchmarks(benchmarks, "HittableList::hit", fieldCoherent, fieldIncoherent, [&field](const Ray &r)
+  {
+    HitRecord rec;
+    return field.hit(r, Interval(0.001f, INFINITY), rec);
+  });
+  PrimitiveArrays fieldArrays;
+  PrimitiveRef fieldGroup = fieldArrays.add(field);
+  addRayBenchmarks(benchmarks, "PrimitiveArrays::hit", fieldCoherent, fieldIncoherent, [&fieldArrays, fieldGroup](const Ray &r)
+  {
+    HitRecord rec;
+    return fieldArrays.hit(fieldGroup, r, Interval(0.001f, INFINITY), rec);
+  });
+  addRayBenchmarks(benchmarks, "BVHNode::hit", fieldCoherent, fieldIncoherent, [&bvh](const Ray &r)
+  {
+    HitRecord rec;
+    return bvh.hit(r, Interval(0.001f, INFINITY), rec);
+  });
+
+  // Sampling kernels, one item is one sample
+  std::vector<glm::vec3> normals;
+  std::vector<glm::vec3> points;
+  for (const Ray &r : incoherent)
+  {
+    normals.push_back(r.direction());
+    points.push_back(r.origin());
+  }
+
+  benchmarks.push_back({"ONB::ONB", normals.size(), [&normals](size_t iterations)
+  {
+    for (size_t i = 0; i < iterations; i++)
+    {
+      for (const auto &normal : normals)
+        doNotOptimize(ONB(normal).axis);
+    }
+  }, 0});
+
+  benchmarks.push_back({"randomCosineDirection", RAY_COUNT, [](size_t iterations)
+  {
+    for (size_t i = 0; i < iterations; i++)
+    {
+      Utils::Random::RNG rng(static_cast<uint32_t>(i), 0);
+      for (size_t s = 0; s < RAY_COUNT; s++)
+        doNotOptimize(Utils::Random::randomCosineDirection(rng));
+    }
+  }, 0});
+
+  // Light sampling as the integrator does it: a mixture of the light's and the cosine PDF at a surface point.
+  // "prebuilt" reuses one mixture, "per_sample" builds it for every sample like Camera::rayColor. Both are
+  // value types on the stack, so neither may allocate
+  auto light = std::make_shared<Quad>(glm::vec3(-1, 4, -1), glm::vec3(2, 0, 0), glm::vec3(0, 0, 2), material);
+  benchmarks.push_back({"MixturePDF::generate+value/prebuilt", RAY_COUNT, [light](size_t iterations)
+  {
+    MixturePDF mixture(HittablePDF(*light, glm::vec3(0)), CosinePDF(glm::vec3(0, 1, 0)));
+    for (size_t i = 0; i < iterations; i++)
+    {
+      Utils::Random::RNG rng(static_cast<uint32_t>(i), 0);
+      for (size_t s = 0; s < RAY_COUNT; s++)
+      {
+        glm::vec3 direction = mixture.generate(rng);
+        doNotOptimize(mixture.value(direction));
+      }
+    }
+  }, 0});
+  benchmarks.push_back({"MixturePDF::generate+value/per_sample", points.size(), [&points, &normals, light](size_t iterations)
+  {
+    for (size_t i = 0; i < iterations; i++)
+    {
+      Utils::Random::RNG rng(static_cast<uint32_t>(i), 0);
+      for (size_t s = 0; s < points.size(); s++)
+      {
+        MixturePDF mixture(HittablePDF(*light, points[s]), CosinePDF(normals[s]));
+        glm::vec3 direction = mixture.generate(rng);
+        doNotOptimize(mixture.value(direction));
+      }
+    }
+  }, 0});
+
+  // Whole paths through the Cornell box on one thread and one tile, one item is one path. Scheduling a frame
+  // allocates its loop body and the tile's task; the budget allows exactly that, so any allocation made per
+  // path or bounce fails it
+  World cornell = cornellBoxWorld();
+  Camera camera(PATH_IMAGE_SIZE, PATH_IMAGE_SIZE, cornell.camPos, 1, 50);
+  camera.setThreadCount(1);
+  camera.setTileSize(PATH_IMAGE_SIZE);
+  std::vector<glm::vec3> accumulation(PATH_IMAGE_SIZE * PATH_IMAGE_SIZE);
+  std::vector<int> sampleCount(PATH_IMAGE_SIZE * PATH_IMAGE_SIZE);
+  camera.render(cornell, accumulation, sampleCount); // Registers the thread's counters before timing
+  benchmarks.push_back({"Camera::render/cornell_paths", accumulation.size(), [&cornell, &camera, &accumulation, &sampleCount](size_t iterations)
+  {
+    for (size_t i = 0; i < iterations; i++)
+      camera.render(cornell, accumulation, sampleCount);
+    doNotOptimize(accumulation.front());
+  }, 2});
+
+  std::vector<Microbench::Result> results = Microbench::runBenchmarks(benchmarks, options);
+  for (const auto &result : results)
+  {
+    if (result.overAllocationBudget)
+    {
+      std::cerr << result.name << " allocated " << result.allocationsPerItem << " times per item, more than its budget\n";
+      return 1;
+    }
+  }
+  return 0;
+}
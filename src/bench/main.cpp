@@ -0,0 +1,318 @@
+#include "render/camera/camera.h"
+#include "render/init/world.h"
+#include "render/init/scene_registry.h"
+#include "render/parallel/thread_pool.h"
+#include "render/stats/ray_stats.h"
+#include "bench/results.h"
+#include "bench/statistics.h"
+#include "git_revision.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Reproducible render benchmarks: a fixed suite of scenes and configurations, each rendered after warmup
+// runs and timed repeatedly. Results are written as JSON/CSV/text, and two JSON files can be compared.
+namespace
+{
+  // One configuration of the suite. threads == 0 means every hardware thread.
+  struct BenchCase
+  {
+    std::string scene;
+    BVHSplitMethod split = BVHSplitMethod::SAH;
+    int bvhWidth = 2;
+    unsigned int spp = 4;
+    unsigned int maxDepth = 50;
+    unsigned int threads = 0;
+    bool roulette = true; // Russian roulette with the camera's default settings
+  };
+
+  std::string bvhLabel(const BenchCase &config)
+  {
+    // Only the 400 sphere scene has a top-level BVH whose build options the suite varies
+    if (config.scene != "spheres400")
+      return "-";
+    const char *split = config.split == BVHSplitMethod::Median ? "median" : config.split == BVHSplitMethod::LBVH ? "lbvh" : "sah";
+    return std::string(split) + (config.bvhWidth == 2 ? "" : std::to_string(config.bvhWidth));
+  }
+
+  std::string caseName(const BenchCase &config)
+  {
+    return config.scene + " bvh=" + bvhLabel(config) + " spp=" + std::to_string(config.spp) +
+           " depth=" + std::to_string(config.maxDepth) +
+           " threads=" + (config.threads == 0 ? std::string("all") : std::to_string(config.threads)) +
+           (config.roulette ? "" : " rr=off");
+  }
+
+  // The fixed suite. Names identify cases between runs, so append new cases rather than changing existing ones.
+  std::vector<BenchCase> benchSuite()
+  {
+    std::vector<BenchCase> suite;
+    for (const char *scene : {"spheres", "spheres400", "quads", "lit", "cornell"})
+      suite.push_back({scene});
+
+    // BVH strategies
+    suite.push_back({"spheres400", BVHSplitMethod::Median});
+    suite.push_back({"spheres400", BVHSplitMethod::LBVH});
+    suite.push_back({"spheres400", BVHSplitMethod::SAH, 4});
+    suite.push_back({"spheres400", BVHSplitMethod::SAH, 8});
+
+    // Sample count, path depth and threading
+    suite.push_back({"cornell", BVHSplitMethod::SAH, 2, 16});
+    suite.push_back({"cornell", BVHSplitMethod::SAH, 2, 4, 8});
+    suite.push_back({"cornell", BVHSplitMethod::SAH, 2, 4, 50, 1});
+    suite.push_back({"spheres400", BVHSplitMethod::SAH, 2, 4, 50, 1});
+
+    // Paths running to full depth, the time Russian roulette saves
+    suite.push_back({"cornell", BVHSplitMethod::SAH, 2, 4, 50, 0, false});
+    return suite;
+  }
+
+  World buildScene(const BenchCase &config, ThreadPool &pool)
+  {
+    if (config.scene == "spheres400")
+    {
+      BVHBuildOptions options;
+      options.splitMethod = config.split;
+      options.width = config.bvhWidth;
+      options.pool = &pool;
+      return complexSphereWorld(options);
+    }
+    return *SceneRegistry::builtin().create(config.scene, &pool);
+  }
+
+  std::string utcTimestamp()
+  {
+    std::time_t now = std::time(nullptr);
+    char text[32];
+    std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    return text;
+  }
+
+  // Prints every case found in both runs and whether it changed significantly, returns whether any regressed.
+  bool compareRuns(const BenchRun &base, const BenchRun &current, double thresholdPercent, double alpha)
+  {
+    std::map<std::string, const BenchResult *> baseResults;
+    for (const auto &result : base.results)
+      baseResults[result.name] = &result;
+
+    std::printf("Comparing %s (%s) against base %s (%s)\n", current.revision.c_str(), current.timestamp.c_str(),
+                base.revision.c_str(), base.timestamp.c_str());
+    std::printf("Significant: median changed by more than %.1f%% with Welch's t-test p < %.3f\n\n", thresholdPercent, alpha);
+    std::printf("%-52s %10s %10s %8s %8s  %s\n", "case", "base [s]", "new [s]", "change", "p", "verdict");
+
+    bool regressed = false;
+    for (const auto &result : current.results)
+    {
+      auto found = baseResults.find(result.name);
+      if (found == baseResults.end())
+      {
+        std::printf("%-52s %10s %10.4f %8s %8s  %s\n", result.name.c_str(), "-", result.summary.median, "-", "-", "new");
+        continue;
+      }
+      const BenchResult &before = *found->second;
+      double change = 100.0 * (result.summary.median - before.summary.median) / before.summary.median;
+      double p = welchPValue(before.samples, result.samples);
+      const char *verdict = "same";
+      if (p < alpha && change > thresholdPercent)
+      {
+        verdict = "REGRESSION";
+        regressed = true;
+      }
+      else if (p < alpha && change < -thresholdPercent)
+        verdict = "improvement";
+      std::printf("%-52s %10.4f %10.4f %+7.1f%% %8.4f  %s\n", result.name.c_str(), before.summary.median,
+                  result.summary.median, change, p, verdict);
+      baseResults.erase(found);
+    }
+    for (const auto &[name, result] : baseResults)
+      std::printf("%-52s %10.4f %10s %8s %8s  %s\n", name.c_str(), result->summary.median, "-", "-", "-", "removed");
+
+    // Scenes are built once per case, so build times are listed for reference without a significance test
+    std::printf("\n%-52s %10s %10s %8s %10s %10s\n", "scene build", "base [s]", "new [s]", "change", "base nodes", "new nodes");
+    for (const auto &result : current.results)
+    {
+      auto found = std::find_if(base.results.begin(), base.results.end(), [&](const BenchResult &before) { return before.name == result.name; });
+      if (found == base.results.end())
+        continue;
+      double change = found->buildSeconds > 0.0 ? 100.0 * (result.buildSeconds - found->buildSeconds) / found->buildSeconds : 0.0;
+      std::printf("%-52s %10.4f %10.4f %+7.1f%% %10zu %10zu\n", result.name.c_str(), found->buildSeconds, result.buildSeconds,
+                  change, found->bvhNodes, result.bvhNodes);
+    }
+    return regressed;
+  }
+
+  void printUsage()
+  {
+    std::cerr << "Usage: lumi_bench [options]\n"
+              << "       lumi_bench --compare BASE.json NEW.json [--threshold PERCENT] [--alpha P]\n"
+              << "  --repeats N      timed runs per case (default 5)\n"
+              << "  --warmup N       untimed runs per case (default 1)\n"
+              << "  --width N        image width (default 256)\n"
+              << "  --height N       image height (default 256)\n"
+              << "  --filter TEXT    only run cases whose name contains TEXT\n"
+              << "  --list           print the case names and exit\n"
+              << "  --json FILE      write results as JSON (the input of --compare)\n"
+              << "  --csv FILE       write results as CSV\n"
+              << "  --text FILE      write a human readable table, e.g. performance.txt\n"
+              << "  --threshold PCT  smallest median change reported by --compare (default 2)\n"
+              << "  --alpha P        significance level of --compare (default 0.05)\n";
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned int repeats = 5;
+  unsigned int warmup = 1;
+  unsigned int width = 256;
+  unsigned int height = 256;
+  double thresholdPercent = 2.0;
+  double alpha = 0.05;
+  bool listOnly = false;
+  std::string filter, jsonPath, csvPath, textPath;
+  std::vector<std::string> comparePaths;
+
+  for (int i = 1; i < argc; i++)
+  {
+    std::string_view option(argv[i]);
+    bool hasValue = i + 1 < argc;
+    if (option == "--list")
+      listOnly = true;
+    else if (option == "--compare" && i + 2 < argc)
+    {
+      comparePaths = {argv[i + 1], argv[i + 2]};
+      i += 2;
+    }
+    else if (option == "--repeats" && hasValue)
+      repeats = std::stoul(argv[++i]);
+    else if (option == "--warmup" && hasValue)
+      warmup = std::stoul(argv[++i]);
+    else if (option == "--width" && hasValue)
+      width = std::stoul(argv[++i]);
+    else if (option == "--height" && hasValue)
+      height = std::stoul(argv[++i]);
+    else if (option == "--filter" && hasValue)
+      filter = argv[++i];
+    else if (option == "--json" && hasValue)
+      jsonPath = argv[++i];
+    else if (option == "--csv" && hasValue)
+      csvPath = argv[++i];
+    else if (option == "--text" && hasValue)
+      textPath = argv[++i];
+    else if (option == "--threshold" && hasValue)
+      thresholdPercent = std::stod(argv[++i]);
+    else if (option == "--alpha" && hasValue)
+      alpha = std::stod(argv[++i]);
+    else
+    {
+      printUsage();
+      return option == "--help" ? 0 : 1;
+    }
+  }
+
+  if (!comparePaths.empty())
+  {
+    BenchRun base, current;
+    if (!readJSON(comparePaths[0], base) || !readJSON(comparePaths[1], current))
+      return 2;
+    return compareRuns(base, current, thresholdPercent, alpha) ? 1 : 0;
+  }
+
+  std::vector<BenchCase> cases;
+  for (const auto &config : benchSuite())
+  {
+    if (caseName(config).find(filter) != std::string::npos)
+      cases.push_back(config);
+  }
+  if (listOnly)
+  {
+    for (const auto &config : cases)
+      std::cout << caseName(config) << "\n";
+    return 0;
+  }
+  if (repeats == 0 || width == 0 || height == 0)
+  {
+    std::cerr << "Repeats, width and height must be positive\n";
+    return 1;
+  }
+
+  BenchRun run;
+  run.revision = LUMI_GIT_REVISION;
+  run.timestamp = utcTimestamp();
+  run.hardwareThreads = ThreadPool::defaultThreadCount();
+  run.warmup = warmup;
+  run.repeats = repeats;
+
+  for (const auto &config : cases)
+  {
+    unsigned int threads = config.threads == 0 ? run.hardwareThreads : config.threads;
+    ThreadPool buildPool(threads);
+    auto buildStart = std::chrono::steady_clock::now();
+    World world = buildScene(config, buildPool);
+    double buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+
+    // One sample per pixel per pass like lumi_cli. Every image starts from empty buffers and the sample
+    // RNG is keyed by pixel and sample index, so each run traces exactly the same paths
+    Camera camera(width, height, world.camPos, 1, config.maxDepth);
+    camera.setThreadCount(threads);
+    if (!config.roulette)
+      camera.setRussianRoulette(RussianRoulette{0});
+    std::vector<glm::vec3> accumulationBuffer(static_cast<size_t>(width) * height);
+    std::vector<int> sampleCount(accumulationBuffer.size());
+    auto renderImage = [&]
+    {
+      std::fill(accumulationBuffer.begin(), accumulationBuffer.end(), glm::vec3(0.0f));
+      std::fill(sampleCount.begin(), sampleCount.end(), 0);
+      auto start = std::chrono::steady_clock::now();
+      for (unsigned int pass = 0; pass < config.spp; pass++)
+        camera.render(world, accumulationBuffer, sampleCount);
+      return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    BenchResult result;
+    result.name = caseName(config);
+    result.scene = config.scene;
+    result.bvh = bvhLabel(config);
+    result.width = width;
+    result.height = height;
+    result.spp = config.spp;
+    result.maxDepth = config.maxDepth;
+    result.threads = threads;
+    result.buildSeconds = buildSeconds;
+    result.bvhNodes = world.bvhStats.nodeCount;
+
+    for (unsigned int i = 0; i < warmup; i++)
+      renderImage();
+    Stats::collect();
+    for (unsigned int i = 0; i < repeats; i++)
+      result.samples.push_back(renderImage());
+    result.summary = summarize(result.samples);
+    RayStats stats = Stats::collect();
+    result.raysPerImage = static_cast<double>(stats.tracedRays()) / repeats;
+    result.nodesPerRay = stats.nodesPerRay();
+
+    std::printf("%-52s median %8.4f s  p95 %8.4f s  stddev %7.4f s  %7.3f Mrays/s (primary)", result.name.c_str(),
+                result.summary.median, result.summary.p95, result.summary.stddev, result.primaryMraysPerSecond());
+    if (Stats::enabled)
+      std::printf("  %7.3f Mrays/s  %6.1f nodes/ray", result.mraysPerSecond(), result.nodesPerRay);
+    std::printf("  build %7.4f s  %7zu nodes\n", result.buildSeconds, result.bvhNodes);
+    std::fflush(stdout);
+    run.results.push_back(result);
+  }
+
+  bool written = true;
+  if (!jsonPath.empty())
+    written = writeJSON(jsonPath, run) && written;
+  if (!csvPath.empty())
+    written = writeCSV(csvPath, run) && written;
+  if (!textPath.empty())
+    written = writeText(textPath, run) && written;
+  return written ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+#include "microbench.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+// The microbenchmarks replace the global allocation functions to count heap allocations. The array and
+// nothrow forms forward to these, so every allocation made through new is seen.
+namespace
+{
+    std::atomic<size_t> allocations{0};
+
+    void *countedAllocation(std::size_t size, std::size_t alignment)
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        if (size == 0)
+            size = 1;
+        void *memory = alignment > alignof(std::max_align_t)
+                           ? std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)
+                           : std::malloc(size);
+        if (!memory)
+            throw std::bad_alloc();
+        return memory;
+    }
+}
+
+void *operator new(std::size_t size) { return countedAllocation(size, alignof(std::max_align_t)); }
+void *operator new(std::size_t size, std::align_val_t alignment) { return countedAllocation(size, static_cast<std::size_t>(alignment)); }
+void operator delete(void *memory) noexcept { std::free(memory); }
+void operator delete(void *memory, std::size_t) noexcept { std::free(memory); }
+void operator delete(void *memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void *memory, std::size_t, std::align_val_t) noexcept { std::free(memory); }
+
+namespace Microbench
+{
+    size_t allocationCount()
+    {
+        return allocations.load(std::memory_order_relaxed);
+    }
+
+    namespace
+    {
+        double timeRun(const Benchmark &benchmark, size_t iterations)
+        {
+            auto start = std::chrono::steady_clock::now();
+            benchmark.run(iterations);
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+
+    std::vector<Result> runBenchmarks(const std::vector<Benchmark> &benchmarks, const Options &options)
+    {
+        std::vector<Result> results;
+        std::printf("%-44s %12s %12s %14s %12s\n", "benchmark", "iterations", "ns/item", "items/s", "allocs/item");
+        for (const auto &benchmark : benchmarks)
+        {
+            if (benchmark.name.find(options.filter) == std::string::npos)
+                continue;
+
+            // Grow the iteration count until a run is long enough to time reliably (also warms caches up)
+            size_t iterations = 1;
+            double seconds = timeRun(benchmark, iterations);
+            while (seconds < options.minSeconds && iterations < (size_t(1) << 40))
+            {
+                double scale = seconds > 0.0 ? 1.4 * options.minSeconds / seconds : 10.0;
+                iterations = std::max(iterations + 1, static_cast<size_t>(static_cast<double>(iterations) * std::min(scale, 10.0)));
+                seconds = timeRun(benchmark, iterations);
+            }
+
+            std::vector<double> perItem;
+            int repetitions = std::max(options.repetitions, 1);
+            perItem.reserve(repetitions);
+            double items = static_cast<double>(iterations) * static_cast<double>(benchmark.itemsPerIteration);
+            size_t allocationsBefore = allocationCount();
+            for (int i = 0; i < repetitions; i++)
+                perItem.push_back(timeRun(benchmark, iterations) * 1e9 / items);
+            size_t allocated = allocationCount() - allocationsBefore;
+            std::sort(perItem.begin(), perItem.end());
+
+            Result result;
+            result.name = benchmark.name;
+            result.iterations = iterations;
+            result.nanosecondsPerItem = perItem[perItem.size() / 2];
+            result.minNanosecondsPerItem = perItem.front();
+            result.maxNanosecondsPerItem = perItem.back();
+            result.allocationsPerItem = static_cast<double>(allocated) / (items * repetitions);
+            result.overAllocationBudget = benchmark.maxAllocationsPerIteration &&
+                                          allocated > *benchmark.maxAllocationsPerIteration * iterations * repetitions;
+            std::printf("%-44s %12zu %12.2f %14.4g %12.4g%s\n", result.name.c_str(), result.iterations,
+                        result.nanosecondsPerItem, result.itemsPerSecond(), result.allocationsPerItem,
+                        result.overAllocationBudget ? "  over allocation budget" : "");
+            std::fflush(stdout);
+            results.push_back(result);
+        }
+        return results;
+    }
+}
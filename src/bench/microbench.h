@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Minimal microbenchmark harness in the style of Google Benchmark: a benchmark body runs a given number
+// of iterations, each processing itemsPerIteration items (e.g. every ray of a ray set once). The runner
+// grows the iteration count until one run takes at least minSeconds, then times repeated runs and
+// reports the median time per item. Heap allocations made during the timed runs are counted as well.
+namespace Microbench
+{
+    // Keeps the compiler from optimising away a computed value.
+    template <typename T>
+    inline void doNotOptimize(const T &value)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile const T *sink;
+        sink = &value;
+#endif
+    }
+
+    struct Benchmark
+    {
+        std::string name;
+        size_t itemsPerIteration = 1;
+        std::function<void(size_t iterations)> run;
+        std::optional<size_t> maxAllocationsPerIteration; // Checked when set, 0 for kernels that must not allocate
+    };
+
+    struct Options
+    {
+        double minSeconds = 0.1; // Shortest timed run
+        int repetitions = 5;     // Timed runs per benchmark, the median is reported
+        std::string filter;      // Only run benchmarks whose name contains this
+    };
+
+    struct Result
+    {
+        std::string name;
+        size_t iterations = 0;
+        double nanosecondsPerItem = 0.0; // Median over the repetitions
+        double minNanosecondsPerItem = 0.0;
+        double maxNanosecondsPerItem = 0.0;
+        double allocationsPerItem = 0.0;
+        bool overAllocationBudget = false; // Allocated more than maxAllocationsPerIteration
+
+        double itemsPerSecond() const { return nanosecondsPerItem > 0.0 ? 1e9 / nanosecondsPerItem : 0.0; }
+    };
+
+    // Heap allocations made through operator new by any thread since the program started.
+    size_t allocationCount();
+
+    // Runs the matching benchmarks, printing one line per benchmark as it finishes.
+    std::vector<Result> runBenchmarks(const std::vector<Benchmark> &benchmarks, const Options &options);
+}
@@ -0,0 +1,320 @@
+#include "results.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+namespace
+{
+    std::string quoted(const std::string &text)
+    {
+        std::string result = "\"";
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                result += '\\';
+            result += c;
+        }
+        return result + "\"";
+    }
+
+    bool openForWriting(std::ofstream &file, const std::string &path)
+    {
+        file.open(path);
+        if (!file)
+            std::cout << "Cannot open " << path << " for writing" << std::endl;
+        return static_cast<bool>(file);
+    }
+
+    // Just enough of JSON to read back the files written by writeJSON.
+    struct JSONValue
+    {
+        enum class Type
+        {
+            Null,
+            Number,
+            String,
+            Array,
+            Object
+        };
+
+        Type type = Type::Null;
+        double number = 0.0;
+        std::string string;
+        std::vector<JSONValue> array;
+        std::map<std::string, JSONValue> object;
+
+        const JSONValue &operator[](const std::string &key) const
+        {
+            static const JSONValue null;
+            auto found = object.find(key);
+            return found == object.end() ? null : found->second;
+        }
+    };
+
+    class JSONParser
+    {
+    public:
+        explicit JSONParser(const std::string &text) : text(text) {}
+
+        bool parse(JSONValue &value)
+        {
+            return parseValue(value) && (skipSpace(), position == text.size());
+        }
+
+    private:
+        void skipSpace()
+        {
+            while (position < text.size() && std::isspace(static_cast<unsigned char>(text[position])))
+                position++;
+        }
+
+        bool consume(char c)
+        {
+            skipSpace();
+            if (position < text.size() && text[position] == c)
+            {
+                position++;
+                return true;
+            }
+            return false;
+        }
+
+        bool parseString(std::string &result)
+        {
+            if (!consume('"'))
+                return false;
+            while (position < text.size() && text[position] != '"')
+            {
+                if (text[position] == '\\' && position + 1 < text.size())
+                    position++;
+                result += text[position++];
+            }
+            return consume('"');
+        }
+
+        bool parseValue(JSONValue &value)
+        {
+            skipSpace();
+            if (position >= text.size())
+                return false;
+
+            char c = text[position];
+            if (c == '"')
+            {
+                value.type = JSONValue::Type::String;
+                return parseString(value.string);
+            }
+            if (c == '[')
+            {
+                position++;
+                value.type = JSONValue::Type::Array;
+                if (consume(']'))
+                    return true;
+                do
+                {
+                    value.array.emplace_back();
+                    if (!parseValue(value.array.back()))
+                        return false;
+                } while (consume(','));
+                return consume(']');
+            }
+            if (c == '{')
+            {
+                position++;
+                value.type = JSONValue::Type::Object;
+                if (consume('}'))
+                    return true;
+                do
+                {
+                    std::string key;
+                    if (!parseString(key) || !consume(':') || !parseValue(value.object[key]))
+                        return false;
+                } while (consume(','));
+                return consume('}');
+            }
+            if (text.compare(position, 4, "null") == 0)
+            {
+                position += 4;
+                return true;
+            }
+
+            const char *start = text.c_str() + position;
+            char *end = nullptr;
+            value.number = std::strtod(start, &end);
+            if (end == start)
+                return false;
+            value.type = JSONValue::Type::Number;
+            position += static_cast<size_t>(end - start);
+            return true;
+        }
+
+        const std::string &text;
+        size_t position = 0;
+    };
+}
+
+double BenchResult::primaryMraysPerSecond() const
+{
+    if (summary.median <= 0.0)
+        return 0.0;
+    return static_cast<double>(width) * height * spp / summary.median / 1e6;
+}
+
+double BenchResult::mraysPerSecond() const
+{
+    return summary.median > 0.0 ? raysPerImage / summary.median / 1e6 : 0.0;
+}
+
+bool writeJSON(const std::string &path, const BenchRun &run)
+{
+    std::ofstream file;
+    if (!openForWriting(file, path))
+        return false;
+
+    file << std::setprecision(9);
+    file << "{\n"
+         << "  \"revision\": " << quoted(run.revision) << ",\n"
+         << "  \"timestamp\": " << quoted(run.timestamp) << ",\n"
+         << "  \"hardware_threads\": " << run.hardwareThreads << ",\n"
+         << "  \"warmup\": " << run.warmup << ",\n"
+         << "  \"repeats\": " << run.repeats << ",\n"
+         << "  \"results\": [";
+    for (size_t i = 0; i < run.results.size(); i++)
+    {
+        const BenchResult &result = run.results[i];
+        file << (i ? ",\n" : "\n")
+             << "    {\"name\": " << quoted(result.name)
+             << ", \"scene\": " << quoted(result.scene)
+             << ", \"bvh\": " << quoted(result.bvh)
+             << ", \"width\": " << result.width
+             << ", \"height\": " << result.height
+             << ", \"spp\": " << result.spp
+             << ", \"max_depth\": " << result.maxDepth
+             << ", \"threads\": " << result.threads
+             << ",\n     \"median\": " << result.summary.median
+             << ", \"p95\": " << result.summary.p95
+             << ", \"mean\": " << result.summary.mean
+             << ", \"stddev\": " << result.summary.stddev
+             << ", \"min\": " << result.summary.min
+             << ", \"max\": " << result.summary.max
+             << ", \"primary_mrays_per_second\": " << result.primaryMraysPerSecond()
+             << ",\n     \"rays_per_image\": " << result.raysPerImage
+             << ", \"mrays_per_second\": " << result.mraysPerSecond()
+             << ", \"nodes_per_ray\": " << result.nodesPerRay
+             << ", \"build_seconds\": " << result.buildSeconds
+             << ", \"bvh_nodes\": " << result.bvhNodes
+             << ",\n     \"samples\": [";
+        for (size_t s = 0; s < result.samples.size(); s++)
+            file << (s ? ", " : "") << result.samples[s];
+        file << "]}";
+    }
+    file << "\n  ]\n}\n";
+    return static_cast<bool>(file);
+}
+
+bool writeCSV(const std::string &path, const BenchRun &run)
+{
+    std::ofstream file;
+    if (!openForWriting(file, path))
+        return false;
+
+    file << std::setprecision(9);
+    file << "revision,name,scene,bvh,width,height,spp,max_depth,threads,median,p95,mean,stddev,min,max,primary_mrays_per_second,rays_per_image,mrays_per_second,nodes_per_ray,build_seconds,bvh_nodes\n";
+    for (const auto &result : run.results)
+    {
+        file << run.revision << "," << result.name << "," << result.scene << "," << result.bvh << ","
+             << result.width << "," << result.height << "," << result.spp << "," << result.maxDepth << "," << result.threads << ","
+             << result.summary.median << "," << result.summary.p95 << "," << result.summary.mean << ","
+             << result.summary.stddev << "," << result.summary.min << "," << result.summary.max << ","
+             << result.primaryMraysPerSecond() << "," << result.raysPerImage << ","
+             << result.mraysPerSecond() << "," << result.nodesPerRay << "," << result.buildSeconds << "," << result.bvhNodes << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+bool writeText(const std::string &path, const BenchRun &run)
+{
+    std::ofstream file;
+    if (!openForWriting(file, path))
+        return false;
+
+    file << "Generated by lumi_bench at revision " << run.revision << ", " << run.timestamp << "\n"
+         << "Hardware threads: " << run.hardwareThreads << ", warmup runs: " << run.warmup << ", timed runs: " << run.repeats << "\n\n";
+
+    // One block per scene, in the order the scenes first appear
+    std::vector<std::string> scenes;
+    for (const auto &result : run.results)
+    {
+        if (std::find(scenes.begin(), scenes.end(), result.scene) == scenes.end())
+            scenes.push_back(result.scene);
+    }
+    for (const auto &scene : scenes)
+    {
+        file << (scene == scenes.front() ? "" : "\n") << scene << ":\n";
+        for (const auto &result : run.results)
+        {
+            if (result.scene != scene)
+                continue;
+            char line[320];
+            std::snprintf(line, sizeof(line), "  %ux%u bvh=%-7s spp=%-4u depth=%-5u threads=%-3u  median %9.4f s  p95 %9.4f s  stddev %8.4f s  %8.3f Mrays/s (primary)  %8.3f Mrays/s  %6.1f nodes/ray  build %8.4f s  %7zu nodes\n",
+                          result.width, result.height, result.bvh.c_str(), result.spp, result.maxDepth, result.threads,
+                          result.summary.median, result.summary.p95, result.summary.stddev, result.primaryMraysPerSecond(),
+                          result.mraysPerSecond(), result.nodesPerRay, result.buildSeconds, result.bvhNodes);
+            file << line;
+        }
+    }
+    return static_cast<bool>(file);
+}
+
+bool readJSON(const std::string &path, BenchRun &run)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cout << "Cannot open " << path << std::endl;
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string text = buffer.str();
+
+    JSONValue root;
+    if (!JSONParser(text).parse(root) || root.type != JSONValue::Type::Object)
+    {
+        std::cout << path << " is not a lumi_bench result file" << std::endl;
+        return false;
+    }
+
+    run.revision = root["revision"].string;
+    run.timestamp = root["timestamp"].string;
+    run.hardwareThreads = static_cast<unsigned int>(root["hardware_threads"].number);
+    run.warmup = static_cast<unsigned int>(root["warmup"].number);
+    run.repeats = static_cast<unsigned int>(root["repeats"].number);
+    for (const auto &entry : root["results"].array)
+    {
+        BenchResult result;
+        result.name = entry["name"].string;
+        result.scene = entry["scene"].string;
+        result.bvh = entry["bvh"].string;
+        result.width = static_cast<unsigned int>(entry["width"].number);
+        result.height = static_cast<unsigned int>(entry["height"].number);
+        result.spp = static_cast<unsigned int>(entry["spp"].number);
+        result.maxDepth = static_cast<unsigned int>(entry["max_depth"].number);
+        result.threads = static_cast<unsigned int>(entry["threads"].number);
+        result.raysPerImage = entry["rays_per_image"].number;
+        result.nodesPerRay = entry["nodes_per_ray"].number;
+        result.buildSeconds = entry["build_seconds"].number; // Zero in files written before builds were timed
+        result.bvhNodes = static_cast<size_t>(entry["bvh_nodes"].number);
+        for (const auto &sample : entry["samples"].array)
+            result.samples.push_back(sample.number);
+        result.summary = summarize(result.samples);
+        run.results.push_back(result);
+    }
+    return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "statistics.h"
+
+// Timings of one benchmark case: a scene rendered with one configuration.
+struct BenchResult
+{
+    std::string name; // Stable identifier used to match cases between runs
+    std::string scene;
+    std::string bvh;
+    unsigned int width = 0;
+    unsigned int height = 0;
+    unsigned int spp = 0;
+    unsigned int maxDepth = 0;
+    unsigned int threads = 0;
+    std::vector<double> samples; // Seconds per rendered image
+    SampleSummary summary;
+    double raysPerImage = 0.0; // All traced rays, zero when stats are compiled out
+    double nodesPerRay = 0.0;
+    double buildSeconds = 0.0; // Constructing the scene once, including its BVH
+    size_t bvhNodes = 0;       // Nodes of the scene's main BVH, zero when it has none
+
+    // Camera rays per second at the median time, in millions.
+    double primaryMraysPerSecond() const;
+
+    // All traced rays per second at the median time, in millions.
+    double mraysPerSecond() const;
+};
+
+// All results of one lumi_bench invocation.
+struct BenchRun
+{
+    std::string revision;
+    std::string timestamp;
+    unsigned int hardwareThreads = 0;
+    unsigned int warmup = 0;
+    unsigned int repeats = 0;
+    std::vector<BenchResult> results;
+};
+
+bool writeJSON(const std::string &path, const BenchRun &run);
+bool writeCSV(const std::string &path, const BenchRun &run);
+
+// Human readable table in the spirit of performance.txt.
+bool writeText(const std::string &path, const BenchRun &run);
+
+// Reads a file written by writeJSON, prints the reason and returns false when it cannot.
+bool readJSON(const std::string &path, BenchRun &run);
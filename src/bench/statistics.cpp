@@ -0,0 +1,102 @@
+#include "statistics.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace
+{
+    // Linear interpolation between the closest ranks of sorted samples, q in [0, 1].
+    double quantile(const std::vector<double> &sorted, double q)
+    {
+        double position = q * static_cast<double>(sorted.size() - 1);
+        size_t below = static_cast<size_t>(position);
+        size_t above = std::min(below + 1, sorted.size() - 1);
+        double fraction = position - static_cast<double>(below);
+        return sorted[below] + fraction * (sorted[above] - sorted[below]);
+    }
+
+    double variance(const std::vector<double> &samples, double mean)
+    {
+        double sum = 0.0;
+        for (double sample : samples)
+            sum += (sample - mean) * (sample - mean);
+        return sum / static_cast<double>(samples.size() - 1);
+    }
+
+    // Continued fraction of the incomplete beta function, evaluated with the modified Lentz method.
+    double betaContinuedFraction(double a, double b, double x)
+    {
+        const double tiny = 1e-300;
+        double c = 1.0;
+        double d = 1.0 - (a + b) * x / (a + 1.0);
+        d = 1.0 / (std::abs(d) < tiny ? tiny : d);
+        double result = d;
+        for (int m = 1; m <= 300; m++)
+        {
+            for (int odd = 0; odd < 2; odd++)
+            {
+                double numerator = odd == 0
+                                       ? m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m))
+                                       : -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1));
+                d = 1.0 + numerator * d;
+                d = 1.0 / (std::abs(d) < tiny ? tiny : d);
+                c = 1.0 + numerator / c;
+                c = std::abs(c) < tiny ? tiny : c;
+                result *= c * d;
+                if (odd == 1 && std::abs(c * d - 1.0) < 1e-12)
+                    return result;
+            }
+        }
+        return result;
+    }
+
+    // Regularized incomplete beta function I_x(a, b).
+    double incompleteBeta(double a, double b, double x)
+    {
+        if (x <= 0.0)
+            return 0.0;
+        if (x >= 1.0)
+            return 1.0;
+        double front = std::exp(std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) + a * std::log(x) + b * std::log(1.0 - x));
+        // The continued fraction converges quickly only on one side of the mean, use the symmetry otherwise
+        if (x < (a + 1.0) / (a + b + 2.0))
+            return front * betaContinuedFraction(a, b, x) / a;
+        return 1.0 - front * betaContinuedFraction(b, a, 1.0 - x) / b;
+    }
+}
+
+SampleSummary summarize(std::vector<double> samples)
+{
+    SampleSummary summary;
+    summary.count = samples.size();
+    if (samples.empty())
+        return summary;
+
+    std::sort(samples.begin(), samples.end());
+    summary.median = quantile(samples, 0.5);
+    summary.p95 = quantile(samples, 0.95);
+    summary.min = samples.front();
+    summary.max = samples.back();
+    summary.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<double>(samples.size());
+    summary.stddev = samples.size() > 1 ? std::sqrt(variance(samples, summary.mean)) : 0.0;
+    return summary;
+}
+
+double welchPValue(const std::vector<double> &a, const std::vector<double> &b)
+{
+    if (a.size() < 2 || b.size() < 2)
+        return 1.0;
+
+    double meanA = std::accumulate(a.begin(), a.end(), 0.0) / static_cast<double>(a.size());
+    double meanB = std::accumulate(b.begin(), b.end(), 0.0) / static_cast<double>(b.size());
+    double errorA = variance(a, meanA) / static_cast<double>(a.size());
+    double errorB = variance(b, meanB) / static_cast<double>(b.size());
+    if (errorA + errorB == 0.0)
+        return meanA == meanB ? 1.0 : 0.0;
+
+    // Welch-Satterthwaite degrees of freedom, then the two-sided tail of Student's t distribution
+    double t = (meanA - meanB) / std::sqrt(errorA + errorB);
+    double degrees = (errorA + errorB) * (errorA + errorB) /
+                     (errorA * errorA / static_cast<double>(a.size() - 1) + errorB * errorB / static_cast<double>(b.size() - 1));
+    return incompleteBeta(0.5 * degrees, 0.5, degrees / (degrees + t * t));
+}
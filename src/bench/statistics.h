@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Summary of repeated timings of one benchmark case.
+struct SampleSummary
+{
+    size_t count = 0;
+    double median = 0.0;
+    double p95 = 0.0;
+    double mean = 0.0;
+    double stddev = 0.0; // Sample standard deviation (n - 1)
+    double min = 0.0;
+    double max = 0.0;
+};
+
+SampleSummary summarize(std::vector<double> samples);
+
+// Two-sided p-value of Welch's t-test for a difference between the means of two sample sets,
+// 1 when either set has fewer than two samples.
+double welchPValue(const std::vector<double> &a, const std::vector<double> &b);
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <charconv>
+#include <string_view>
+#include <system_error>
+
+// Parsing of numeric command line values for the executables. Unlike std::stoul and friends nothing throws:
+// text that is not entirely one number within [min, max] is rejected and the value left unchanged.
+namespace Arguments
+{
+  template <typename T>
+  bool parseNumber(std::string_view text, T &value, T min, T max)
+  {
+    T parsed{};
+    const char *end = text.data() + text.size();
+    auto [last, error] = std::from_chars(text.data(), end, parsed);
+    if (error != std::errc() || last != end || !(parsed >= min && parsed <= max))
+      return false;
+    value = parsed;
+    return true;
+  }
+}
@@ -0,0 +1,262 @@
+#include "render/camera/camera.h"
+#include "render/init/world.h"
+#include "render/init/scene_registry.h"
+#include "render/io/image_writer.h"
+#include "render/parallel/thread_pool.h"
+#include "render/stats/ray_stats.h"
+#include "render/stats/traversal_heatmap.h"
+#include "render/stats/profiler.h"
+#include "cli/arguments.h"
+
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Headless batch renderer: renders one scene without a window or GL context, writes the image and prints
+// timing as a single JSON object on stdout. Progress and loader messages go to stderr.
+namespace
+{
+  void printUsage()
+  {
+    std::cerr << "Usage: lumi_cli [options]\n"
+              << "  --scene NAME|FILE   built-in scene or scene file (default cornell)\n"
+              << "  --mesh FILE         render an OBJ/PLY mesh instead of a scene\n"
+              << "  --width N           image width, 1 to 16384 (default 500)\n"
+              << "  --height N          image height, 1 to 16384 (default 500)\n"
+              << "  --spp N             samples per pixel, at least 1 (default 16)\n"
+              << "  --depth N           maximum ray depth, at least 1 (default 50)\n"
+              << "  --rr-start-depth N  bounce from which Russian roulette may end paths, 0 = off (default 3)\n"
+              << "  --rr-min-survival P lowest probability of a path surviving a roulette round, 0.001 to 1 (default 0.05)\n"
+              << "  --threads N         worker threads, 0 = all hardware threads, at most 1024 (default 0)\n"
+              << "  --tile-size N       tile edge in pixels, 1 to 16384 (default 16)\n"
+              << "  --output FILE       .png (gamma corrected) or .pfm (linear), may be repeated (default out.png)\n"
+              << "  --heatmap FILE      also write a traversal cost heatmap, .png (false color) or .pfm (mean counts)\n"
+              << "  --heatmap-source S  primary-nodes (default), primary-primitives, path-nodes or path-primitives\n"
+              << "  --profile FILE      write a Chrome trace (Perfetto, chrome://tracing) of loading, rendering and writing\n";
+  }
+
+  std::string jsonString(const std::string &text)
+  {
+    std::string quoted = "\"";
+    for (char c : text)
+    {
+      if (c == '"' || c == '\\')
+        quoted += '\\';
+      quoted += c;
+    }
+    return quoted + "\"";
+  }
+
+  double secondsSince(std::chrono::steady_clock::time_point start)
+  {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  const unsigned int maxImageEdge = 16384;
+  std::string sceneName = "cornell";
+  std::string meshPath;
+  unsigned int width = 500;
+  unsigned int height = 500;
+  unsigned int samplesPerPixel = 16;
+  unsigned int maxDepth = 50;
+  RussianRoulette roulette;
+  unsigned int threadCount = 0;
+  unsigned int tileSize = 16;
+  std::vector<std::string> outputs;
+  std::string heatmapPath;
+  std::string profilePath;
+  HeatmapSource heatmapSource = HeatmapSource::PrimaryNodes;
+
+  for (int i = 1; i < argc; i += 2)
+  {
+    std::string_view option(argv[i]);
+    if (option == "--help" || i + 1 >= argc)
+    {
+      printUsage();
+      return option == "--help" ? 0 : 1;
+    }
+    std::string value(argv[i + 1]);
+    bool valid = true;
+    if (option == "--scene")
+      sceneName = value;
+    else if (option == "--mesh")
+      meshPath = value;
+    else if (option == "--width")
+      valid = Arguments::parseNumber(value, width, 1u, maxImageEdge);
+    else if (option == "--height")
+      valid = Arguments::parseNumber(value, height, 1u, maxImageEdge);
+    else if (option == "--spp")
+      valid = Arguments::parseNumber(value, samplesPerPixel, 1u, std::numeric_limits<unsigned int>::max());
+    else if (option == "--depth")
+      valid = Arguments::parseNumber(value, maxDepth, 1u, static_cast<unsigned int>(std::numeric_limits<int>::max()));
+    else if (option == "--rr-start-depth")
+      valid = Arguments::parseNumber(value, roulette.startDepth, 0, std::numeric_limits<int>::max());
+    else if (option == "--rr-min-survival")
+      valid = Arguments::parseNumber(value, roulette.minSurvival, 0.001f, 1.0f);
+    else if (option == "--threads")
+      valid = Arguments::parseNumber(value, threadCount, 0u, 1024u);
+    else if (option == "--tile-size")
+      valid = Arguments::parseNumber(value, tileSize, 1u, maxImageEdge);
+    else if (option == "--output")
+      outputs.push_back(value);
+    else if (option == "--heatmap")
+      heatmapPath = value;
+    else if (option == "--profile")
+      profilePath = value;
+    else if (option == "--heatmap-source")
+      valid = parseHeatmapSource(value, heatmapSource);
+    else
+    {
+      std::cerr << "Unknown option " << option << "\n";
+      printUsage();
+      return 1;
+    }
+    if (!valid)
+    {
+      std::cerr << "Invalid value " << value << " for " << option << "\n";
+      printUsage();
+      return 1;
+    }
+  }
+  if (outputs.empty())
+    outputs.push_back("out.png");
+  if (!heatmapPath.empty() && !Stats::enabled)
+  {
+    std::cerr << "Heatmaps need a build with the LUMI_STATS CMake option on\n";
+    return 1;
+  }
+  if (threadCount == 0)
+    threadCount = ThreadPool::defaultThreadCount();
+  if (!profilePath.empty())
+  {
+    Profiler::setEnabled(true);
+    Profiler::setThreadName("main");
+  }
+
+  auto loadStart = std::chrono::steady_clock::now();
+  std::optional<World> world = [&]() -> std::optional<World>
+  {
+    ThreadPool loadPool(threadCount);
+    if (!meshPath.empty())
+      return meshWorld(meshPath, &loadPool);
+    return SceneRegistry::builtin().create(sceneName, &loadPool);
+  }();
+  double loadSeconds = secondsSince(loadStart);
+  if (!world)
+  {
+    if (meshPath.empty())
+      std::cerr << "Cannot load scene " << sceneName << "\n";
+    else
+      std::cerr << "Cannot load mesh " << meshPath << "\n";
+    return 1;
+  }
+
+  // One sample per pixel per pass, so any spp works and the image matches the interactive viewer's
+  Camera camera(width, height, world->camPos, 1, maxDepth);
+  camera.setThreadCount(threadCount);
+  camera.setTileSize(tileSize);
+  camera.setRussianRoulette(roulette);
+
+  const size_t imageSize = static_cast<size_t>(width) * height;
+  std::vector<glm::vec3> accumulationBuffer(imageSize, glm::vec3(0.0f));
+  std::vector<int> sampleCount(imageSize, 0);
+  std::vector<PixelCost> costs(heatmapPath.empty() ? 0 : imageSize);
+  std::vector<PixelCost> *costBuffer = heatmapPath.empty() ? nullptr : &costs;
+
+  Stats::collect(); // Only count the render itself
+  double renderSeconds = 0.0;
+  double fastestPass = INFINITY;
+  for (unsigned int pass = 0; pass < samplesPerPixel; pass++)
+  {
+    auto start = std::chrono::steady_clock::now();
+    camera.render(*world, accumulationBuffer, sampleCount, costBuffer);
+    double seconds = secondsSince(start);
+    renderSeconds += seconds;
+    fastestPass = std::min(fastestPass, seconds);
+    std::cerr << "\rSample " << pass + 1 << "/" << samplesPerPixel << std::flush;
+  }
+  std::cerr << "\n";
+  RayStats stats = Stats::collect();
+
+  std::vector<glm::vec3> image(imageSize);
+  for (size_t i = 0; i < imageSize; i++)
+    image[i] = accumulationBuffer[i] / static_cast<float>(sampleCount[i]);
+
+  auto writeStart = std::chrono::steady_clock::now();
+  bool written = true;
+  for (const auto &output : outputs)
+  {
+    LUMI_PROFILE_SCOPE("write image");
+    written = writeImage(output, width, height, image) && written;
+  }
+  float heatmapScale = 0.0f;
+  if (!heatmapPath.empty())
+  {
+    std::vector<float> values = heatmapValues(costs, sampleCount, heatmapSource);
+    std::vector<glm::vec3> colors = heatmapColors(values, &heatmapScale);
+    if (heatmapPath.size() >= 4 && heatmapPath.compare(heatmapPath.size() - 4, 4, ".pfm") == 0)
+    {
+      std::vector<glm::vec3> counts(values.size());
+      for (size_t i = 0; i < values.size(); i++)
+        counts[i] = glm::vec3(values[i]);
+      written = writePFM(heatmapPath, width, height, counts) && written;
+    }
+    else
+      written = writePNG(heatmapPath, width, height, colors, false) && written;
+  }
+  double writeSeconds = secondsSince(writeStart);
+  if (!profilePath.empty())
+  {
+    Profiler::setEnabled(false);
+    written = Profiler::writeChromeTrace(profilePath) && written;
+  }
+
+  double samples = static_cast<double>(imageSize) * samplesPerPixel;
+  std::cout << "{\"scene\": " << jsonString(meshPath.empty() ? sceneName : meshPath)
+            << ", \"width\": " << width
+            << ", \"height\": " << height
+            << ", \"spp\": " << samplesPerPixel
+            << ", \"max_depth\": " << maxDepth
+            << ", \"russian_roulette\": {\"start_depth\": " << camera.russianRoulette().startDepth
+            << ", \"min_survival\": " << camera.russianRoulette().minSurvival << "}"
+            << ", \"threads\": " << camera.threadCount()
+            << ", \"tile_size\": " << camera.tileSize()
+            << ", \"load_seconds\": " << loadSeconds
+            << ", \"bvh\": {\"build_seconds\": " << world->bvhStats.buildSeconds
+            << ", \"nodes\": " << world->bvhStats.nodeCount
+            << ", \"leaves\": " << world->bvhStats.leafCount
+            << ", \"depth\": " << world->bvhStats.depth << "}"
+            << ", \"render_seconds\": " << renderSeconds
+            << ", \"seconds_per_sample_pass\": " << renderSeconds / samplesPerPixel
+            << ", \"fastest_sample_pass_seconds\": " << fastestPass
+            << ", \"samples_per_second\": " << samples / renderSeconds
+            << ", \"write_seconds\": " << writeSeconds
+            << ", \"stats\": {\"enabled\": " << (Stats::enabled ? "true" : "false")
+            << ", \"primary_rays\": " << stats.primaryRays
+            << ", \"bounce_rays\": " << stats.bounceRays
+            << ", \"light_sample_rays\": " << stats.lightSampleRays
+            << ", \"nodes_visited\": " << stats.nodesVisited
+            << ", \"aabb_tests\": " << stats.aabbTests
+            << ", \"primitive_tests\": " << stats.primitiveTests
+            << ", \"mrays_per_second\": " << stats.tracedRays() / renderSeconds / 1e6
+            << ", \"nodes_per_ray\": " << stats.nodesPerRay()
+            << ", \"mean_path_length\": " << stats.meanPathLength()
+            << ", \"longest_path\": " << stats.longestPath
+            << ", \"path_lengths\": [";
+  for (int i = 0; i < RayStats::pathLengthBins; i++)
+    std::cout << (i ? ", " : "") << stats.pathLengths[i];
+  std::cout << "]}"
+            << ", \"heatmap\": " << (heatmapPath.empty() ? "null" : "{\"path\": " + jsonString(heatmapPath) + ", \"source\": \"" + heatmapSourceName(heatmapSource) + "\", \"red_at\": " + std::to_string(heatmapScale) + "}")
+            << ", \"outputs\": [";
+  for (size_t i = 0; i < outputs.size(); i++)
+    std::cout << (i ? ", " : "") << jsonString(outputs[i]);
+  std::cout << "]}" << std::endl;
+  return written ? 0 : 1;
+}
@@ -1,18 +1,105 @@
-#include "render/init/quad_texture.h"
+#include "render/gui/quad_texture.h"
 #include "render/init/world.h"
+#include "render/init/scene_registry.h"
 #include "render/gui/window/window.h"
 #include "render/shaders/shader.h"
 #include "render/render.h"
 #include "render/gui/imgui/lifecycle/imgui_lifecycle.h"
+#include "render/parallel/thread_pool.h"
+#include "render/stats/profiler.h"
+#include "cli/arguments.h"
 
-int main()
+#include <iostream>
+#include <limits>
+#include <string_view>
+#include <string>
+
+namespace
+{
+  void printUsage()
+  {
+    std::cerr << "Usage: lumi [options]\n"
+              << "  --threads N         worker threads, 0 = all hardware threads, at most 1024 (default 0)\n"
+              << "  --tile-size N       tile edge in pixels, 1 to 16384 (default 16)\n"
+              << "  --scene NAME|FILE   built-in scene or scene file (default cornell)\n"
+              << "  --mesh FILE         render an OBJ/PLY mesh instead of a scene\n"
+              << "  --profile FILE      record a Chrome trace of the session, written on exit\n"
+              << "  --rr-start-depth N  bounce from which Russian roulette may end paths, 0 = off (default 3)\n"
+              << "  --rr-min-survival P lowest probability of a path surviving a roulette round, 0.001 to 1 (default 0.05)\n";
+  }
+}
+
+int main(int argc, char *argv[])
 {
   const unsigned int WIDTH = 500;
   const unsigned int HEIGHT = 500;
   // For full use must be a square number (stratification in square grid)
   const unsigned int SAMPLE_PER_PIXEL = 1;
+  // Only a safety cap: Russian roulette ends almost every path long before it
   const unsigned int MAX_DEPTH = 1000;
-  World world = cornellBox;
+
+  unsigned int threadCount = ThreadPool::defaultThreadCount();
+  unsigned int tileSize = 16;
+  std::string sceneName = "cornell";
+  std::string meshPath;
+  std::string profilePath;
+  RussianRoulette roulette;
+  for (int i = 1; i < argc; i += 2)
+  {
+    std::string_view option(argv[i]);
+    if (option == "--help" || i + 1 >= argc)
+    {
+      printUsage();
+      return option == "--help" ? 0 : 1;
+    }
+    std::string_view value(argv[i + 1]);
+    bool valid = true;
+    if (option == "--threads")
+      valid = Arguments::parseNumber(value, threadCount, 0u, 1024u);
+    else if (option == "--tile-size")
+      valid = Arguments::parseNumber(value, tileSize, 1u, 16384u);
+    else if (option == "--scene")
+      sceneName = value;
+    else if (option == "--mesh")
+      meshPath = value;
+    else if (option == "--profile")
+      profilePath = value;
+    else if (option == "--rr-start-depth")
+      valid = Arguments::parseNumber(value, roulette.startDepth, 0, std::numeric_limits<int>::max());
+    else if (option == "--rr-min-survival")
+      valid = Arguments::parseNumber(value, roulette.minSurvival, 0.001f, 1.0f);
+    else
+    {
+      std::cerr << "Unknown option " << option << "\n";
+      printUsage();
+      return 1;
+    }
+    if (!valid)
+    {
+      std::cerr << "Invalid value " << value << " for " << option << "\n";
+      printUsage();
+      return 1;
+    }
+  }
+
+  // Enabled before any pool exists, so every worker gets a named track
+  if (!profilePath.empty())
+  {
+    Profiler::setEnabled(true);
+    Profiler::setThreadName("main");
+  }
+
+  // Only the requested scene is built. Meshes are parsed and accelerated on a pool that only lives while loading
+  World world = [&]
+  {
+    ThreadPool loadPool(threadCount > 0 ? threadCount : ThreadPool::defaultThreadCount());
+    auto scene = meshPath.empty() ? SceneRegistry::builtin().create(sceneName, &loadPool) : meshWorld(meshPath, &loadPool);
+    return scene ? *scene : cornellBoxWorld();
+  }();
+  if (world.bvhStats.nodeCount > 0)
+    std::cout << "BVH build time: " << world.bvhStats.buildSeconds << " seconds, "
+              << "Nodes: " << world.bvhStats.nodeCount << ", "
+              << "Leaves: " << world.bvhStats.leafCount << std::endl;
 
   const unsigned int IMAGE_SIZE = WIDTH * HEIGHT;
   GLFWwindow *window = createWindow(WIDTH, HEIGHT);
@@ -30,9 +117,18 @@ int main()
   configureTexture(texture, WIDTH, HEIGHT);
 
   Camera camera(WIDTH, HEIGHT, world.camPos, SAMPLE_PER_PIXEL, MAX_DEPTH);
+  camera.setThreadCount(threadCount);
+  camera.setTileSize(tileSize);
+  camera.setRussianRoulette(roulette);
   auto renderer = Render();
   renderer.renderLoop(window, shader, quadVAO, texture, world, camera, IMAGE_SIZE);
 
+  if (!profilePath.empty())
+  {
+    Profiler::setEnabled(false);
+    Profiler::writeChromeTrace(profilePath);
+  }
+
   ImGuiShutdown();
   glfwShutdown(window);
   return 0;
@@ -1,10 +1,14 @@
 #include "camera.h"
 #include "pdf.h"
+#include "stats/ray_stats.h"
+#include "stats/profiler.h"
+#include <algorithm>
 #include <iostream>
 
 Camera::Camera(unsigned int imageWidth, unsigned int imageHeight, const glm::vec3 &pos, const glm::vec3 &focalPoint, const glm::vec3 &up, float vertFov, unsigned int samplesPerPixel, unsigned int maxDepth)
     : imageWidth(imageWidth), imageHeight(imageHeight), center(pos), lookAt(focalPoint),
-      vup(up), vertFOV(vertFov), samplePerPixelPerFrame(samplesPerPixel), maxDepth(maxDepth)
+      vup(up), vertFOV(vertFov), samplePerPixelPerFrame(samplesPerPixel), maxDepth(maxDepth),
+      pool(std::make_unique<ThreadPool>(ThreadPool::defaultThreadCount()))
 {
     initialize();
 }
@@ -46,9 +50,9 @@ void Camera::initialize()
 }
 
 // Get a random ray for a given pixel on the viewport
-Ray Camera::getRandomRay(int x, int y) const
+Ray Camera::getRandomRay(int x, int y, Utils::Random::RNG &rng) const
 {
-    auto offset = Utils::Sampling::sampleUnitSquare();
+    auto offset = Utils::Sampling::sampleUnitSquare(rng);
     auto pixelCenter = pixel00Loc + ((float(x) + offset.x) * pixelDeltaU) + ((float(y) + offset.y) * pixelDeltaV);
     auto rayDirection = pixelCenter - center;
     Ray r(center, rayDirection);
@@ -56,7 +60,7 @@ Ray Camera::getRandomRay(int x, int y) const
 }
 
 // Get a random ray for a stratified square for a given pixel on the viewport
-Ray Camera::getRandomStratifiedRay(glm::vec3 pixelCenter, int gridX, int gridY) const
+Ray Camera::getRandomStratifiedRay(glm::vec3 pixelCenter, int gridX, int gridY, Utils::Random::RNG &rng) const
 {
     // -0.5 as the pixel spans -0.5f to +0.5f and grid top left is 0,0 in indices
     glm::vec3 subPixelX = (gridX * recipSqrtSPPPF - 0.5f) * pixelDeltaU;
@@ -64,7 +68,7 @@ Ray Camera::getRandomStratifiedRay(glm::vec3 pixelCenter, int gridX, int gridY)
 
     auto subPixel = pixelCenter + subPixelX + subPixelY;
 
-    auto offset = Utils::Sampling::sampleUnitSquare() * recipSqrtSPPPF;
+    auto offset = Utils::Sampling::sampleUnitSquare(rng) * recipSqrtSPPPF;
     auto offsetSubPixel = subPixel + offset;
 
     auto rayDirection = offsetSubPixel - center;
@@ -72,43 +76,117 @@ Ray Camera::getRandomStratifiedRay(glm::vec3 pixelCenter, int gridX, int gridY)
     return r;
 }
 
-glm::vec3 Camera::rayColor(const Ray &r, const HittableList &world, const HittableList &lights, int depth) const
+glm::vec3 Camera::rayColor(const Ray &primary, const World &world, Utils::Random::RNG &rng, RayStats *afterPrimary) const
 {
-    if (depth <= 0)
-        return glm::vec3(0.0f);
+    glm::vec3 radiance(0.0f);
+    glm::vec3 throughput(1.0f); // Weight of light reaching the current vertex in the final estimate
+    Ray r = primary;
+    int segments = 0;
 
-    HitRecord rec;
-    if (!world.hit(r, Interval(0.001f, INFINITY), rec))
-        return glm::vec3(0, 0, 0);
+    while (segments < maxDepth)
+    {
+        segments++;
+        if (segments == 1)
+            LUMI_STAT(primaryRays, 1);
+        else
+            LUMI_STAT(bounceRays, 1);
+
+        // Each bounce draws from its own dimensions, so paths stay reproducible whatever happens at other depths
+        rng.startBounce(segments);
+
+        HitRecord rec;
+        bool hit = world.hit(r, Interval(0.001f, INFINITY), rec);
+        if (segments == 1 && afterPrimary)
+            *afterPrimary = Stats::local();
+        if (!hit)
+            break;
+
+        Ray scattered;
+        glm::vec3 attenuation;
+        float pdfValue;
+        const Material &material = world.materials[rec.material];
+        radiance += throughput * material.emitted(rec);
+
+        if (!material.scatter(r, rec, attenuation, scattered, pdfValue, rng))
+            break;
+
+        // TODO: Objects.front is a hack for now, need to support multiple lights eventually
+        MixturePDF mixed_pdf(HittablePDF(*world.lights.objects.front(), rec.point), CosinePDF(rec.normal));
+
+        scattered = Ray(rec.point, mixed_pdf.generate(rng));
+        pdfValue = mixed_pdf.value(scattered.direction());
 
-    Ray scattered;
-    glm::vec3 attenuation;
-    float pdfValue;
-    glm::vec3 colorFromEmission = rec.mat->emitted(rec);
+        float scattering_pdf = material.scatteringPDF(r, rec, scattered);
+        throughput *= attenuation * scattering_pdf / pdfValue;
 
-    if (!rec.mat->scatter(r, rec, attenuation, scattered, pdfValue))
-        return colorFromEmission;
+        if (roulette.enabled() && segments >= roulette.startDepth)
+        {
+            float survival = std::min(1.0f, std::max(roulette.minSurvival, std::max(throughput.x, std::max(throughput.y, throughput.z))));
+            if (rng.nextFloat() >= survival)
+                break;
+            throughput /= survival;
+        }
+        r = scattered;
+    }
+
+    LUMI_STAT_MAX(longestPath, static_cast<uint64_t>(segments));
+    LUMI_STAT(pathLengths[std::clamp(segments, 1, RayStats::pathLengthBins) - 1], 1);
+    return radiance;
+}
+
+void Camera::setRussianRoulette(const RussianRoulette &settings)
+{
+    roulette = settings;
+    roulette.minSurvival = std::clamp(settings.minSurvival, 1e-3f, 1.0f);
+}
 
-    // TODO: Objects.front is a hack for now, need to support multiple lights eventually
-    auto p0 = std::make_shared<HittablePDF>(*lights.objects.front(), rec.point);
-    auto p1 = std::make_shared<CosinePDF>(rec.normal);
-    MixturePDF mixed_pdf(p0, p1);
+void Camera::setThreadCount(unsigned int threadCount)
+{
+    if (threadCount == 0)
+        threadCount = ThreadPool::defaultThreadCount();
+    if (threadCount != pool->threadCount())
+        pool = std::make_unique<ThreadPool>(threadCount);
+}
 
-    scattered = Ray(rec.point, mixed_pdf.generate());
-    pdfValue = mixed_pdf.value(scattered.direction());
+unsigned int Camera::threadCount() const
+{
+    return pool->threadCount();
+}
 
-    float scattering_pdf = rec.mat->scatteringPDF(r, rec, scattered);
+void Camera::setTileSize(unsigned int size)
+{
+    tileEdge = size == 0 ? 1 : static_cast<int>(size);
+}
 
-    glm::vec3 colorFromScatter = (attenuation * scattering_pdf * rayColor(scattered, world, lights, depth - 1)) / pdfValue;
-    return colorFromScatter + colorFromEmission;
+unsigned int Camera::tileSize() const
+{
+    return static_cast<unsigned int>(tileEdge);
 }
 
 // Render the world into the accumulation buffer
-void Camera::render(const World &world, std::vector<glm::vec3> &accumulationBuffer, std::vector<int> &sampleCount)
+void Camera::render(const World &world, std::vector<glm::vec3> &accumulationBuffer, std::vector<int> &sampleCount,
+                    std::vector<PixelCost> *costs)
 {
-    for (int y = 0; y < imageHeight; ++y)
+    LUMI_PROFILE_SCOPE("render frame");
+    int tilesX = (imageWidth + tileEdge - 1) / tileEdge;
+    int tilesY = (imageHeight + tileEdge - 1) / tileEdge;
+
+    pool->parallelFor(tilesX * tilesY, [&](size_t tile)
+    {
+        renderTile(world, static_cast<int>(tile) % tilesX, static_cast<int>(tile) / tilesX, accumulationBuffer, sampleCount, costs);
+    });
+}
+
+void Camera::renderTile(const World &world, int tileX, int tileY, std::vector<glm::vec3> &accumulationBuffer, std::vector<int> &sampleCount,
+                        std::vector<PixelCost> *costs) const
+{
+    LUMI_PROFILE_SCOPE("render tile");
+    int xEnd = std::min((tileX + 1) * tileEdge, imageWidth);
+    int yEnd = std::min((tileY + 1) * tileEdge, imageHeight);
+
+    for (int y = tileY * tileEdge; y < yEnd; ++y)
     {
-        for (int x = 0; x < imageWidth; ++x)
+        for (int x = tileX * tileEdge; x < xEnd; ++x)
         {
             int index = y * imageWidth + x;
             auto pixelCenter = pixel00Loc + (float(x) * pixelDeltaU) + (float(y) * pixelDeltaV);
@@ -117,8 +195,24 @@ void Camera::render(const World &world, std::vector<glm::vec3> &accumulationBuff
             {
                 for (int gridX = 0; gridX < sqrtSamplePerPixelPerFrame; gridX++)
                 {
-                    Ray r = getRandomStratifiedRay(pixelCenter, gridX, gridY);
-                    accumulationBuffer[index] += rayColor(r, world.objects, world.lights, maxDepth);
+                    // Seeded by pixel and running sample index: the image does not depend on thread count or tile order
+                    Utils::Random::RNG rng(index, sampleCount[index]);
+                    Ray r = getRandomStratifiedRay(pixelCenter, gridX, gridY, rng);
+                    if (Stats::enabled && costs)
+                    {
+                        // Cost of the sample is the growth of this thread's counters while tracing it
+                        RayStats before = Stats::local();
+                        RayStats afterPrimary;
+                        accumulationBuffer[index] += rayColor(r, world, rng, &afterPrimary);
+                        const RayStats &after = Stats::local();
+                        PixelCost &cost = (*costs)[index];
+                        cost.primaryNodes += static_cast<float>(afterPrimary.nodesVisited - before.nodesVisited);
+                        cost.primaryPrimitives += static_cast<float>(afterPrimary.primitiveTests - before.primitiveTests);
+                        cost.pathNodes += static_cast<float>(after.nodesVisited - before.nodesVisited);
+                        cost.pathPrimitives += static_cast<float>(after.primitiveTests - before.primitiveTests);
+                    }
+                    else
+                        accumulationBuffer[index] += rayColor(r, world, rng);
                     sampleCount[index] += 1;
                 }
             }
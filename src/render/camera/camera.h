@@ -1,11 +1,26 @@
 #pragma once
 
+#include <memory>
 #include <vector>
 #include "utils.h"
 #include "geometry/hittable/hittable.h"
 #include "geometry/hittable/hittable_list.h"
 #include "material/material.h"
 #include "init/world.h"
+#include "parallel/thread_pool.h"
+#include "stats/ray_stats.h"
+#include "stats/traversal_heatmap.h"
+
+// Russian roulette path termination. From the startDepth-th bounce on, a path continues with probability
+// max(minSurvival, largest channel of its throughput) and the survivors' throughput is divided by that
+// probability, so dim paths stop early while the image stays unbiased. startDepth 0 disables it.
+struct RussianRoulette
+{
+    int startDepth = 3;
+    float minSurvival = 0.05f; // In (0, 1], lower ends more paths at the cost of more noise
+
+    bool enabled() const { return startDepth > 0; }
+};
 
 // Camera class handles ray generation and rendering for the scene.
 class Camera
@@ -15,7 +30,25 @@ public:
     Camera(unsigned int imageWidth, unsigned int imageHeight, const CamPos &camPos, unsigned int samplesPerPixel, unsigned int maxDepth);
 
     // Renders the world into the accumulation buffer.
-    void render(const World &world, std::vector<glm::vec3> &accumulationBuffer, std::vector<int> &sampleCount);
+    // Tiles are rendered in parallel, each pixel belongs to exactly one tile so buffer writes never overlap.
+    // When costs is given, the traversal work of every sample is added to it as well (needs LUMI_ENABLE_STATS).
+    void render(const World &world, std::vector<glm::vec3> &accumulationBuffer, std::vector<int> &sampleCount,
+                std::vector<PixelCost> *costs = nullptr);
+
+    // Number of threads used for rendering (recreates the worker pool).
+    void setThreadCount(unsigned int threadCount);
+    unsigned int threadCount() const;
+
+    // Edge length in pixels of the square tiles the image is split into.
+    void setTileSize(unsigned int size);
+    unsigned int tileSize() const;
+
+    // Termination of long paths, on by default.
+    void setRussianRoulette(const RussianRoulette &settings);
+    const RussianRoulette &russianRoulette() const { return roulette; }
+
+    // Samples each pixel receives per render call.
+    int samplesPerFrame() const { return sqrtSamplePerPixelPerFrame * sqrtSamplePerPixelPerFrame; }
 
     int imageWidth;
     int imageHeight;
@@ -24,14 +57,19 @@ private:
     // Initializes camera settings
     void initialize();
 
+    // Renders every pixel of one tile into the accumulation buffer.
+    void renderTile(const World &world, int tileX, int tileY, std::vector<glm::vec3> &accumulationBuffer, std::vector<int> &sampleCount,
+                    std::vector<PixelCost> *costs) const;
+
     // Generates a random ray for a given pixel.
-    Ray getRandomRay(int x, int y) const;
+    Ray getRandomRay(int x, int y, Utils::Random::RNG &rng) const;
 
     // Generates a random ray for a stratified square for a given pixel.
-    Ray getRandomStratifiedRay(glm::vec3 pixelCenter, int gridX, int gridY) const;
+    Ray getRandomStratifiedRay(glm::vec3 pixelCenter, int gridX, int gridY, Utils::Random::RNG &rng) const;
 
-    // Computes the color of a ray intersecting with the world.
-    glm::vec3 rayColor(const Ray &r, const HittableList &world, const HittableList &lights, int depth) const;
+    // Computes the radiance arriving along a camera ray, following its path iteratively for at most maxDepth segments.
+    // afterPrimary, when given, receives the calling thread's counters right after the camera ray's hit test.
+    glm::vec3 rayColor(const Ray &r, const World &world, Utils::Random::RNG &rng, RayStats *afterPrimary = nullptr) const;
 
     glm::vec3 center;               // Camera center
     glm::vec3 lookAt;               // Point camera is looking at
@@ -41,6 +79,7 @@ private:
     int sqrtSamplePerPixelPerFrame; // To subdivide pixel into a grid
     float recipSqrtSPPPF;
     int maxDepth; // Max number of ray bounces
+    RussianRoulette roulette;
 
     glm::vec3 pixel00Loc;
     glm::vec3 pixelDeltaU; // Offset to pixel to the right
@@ -48,4 +87,7 @@ private:
     glm::vec3 u;           // Camera frame basis vectors
     glm::vec3 v;
     glm::vec3 w;
+
+    std::unique_ptr<ThreadPool> pool; // Persistent render workers
+    int tileEdge = 16;                // Tile size in pixels
 };
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "affine.h"
+
+AffineTransform AffineTransform::translation(const glm::vec3 &offset)
+{
+    AffineTransform t;
+    for (int row = 0; row < 3; row++)
+        t.m[row][3] = offset[row];
+    return t;
+}
+
+AffineTransform AffineTransform::scale(const glm::vec3 &factors)
+{
+    AffineTransform t;
+    for (int row = 0; row < 3; row++)
+        t.m[row][row] = factors[row];
+    return t;
+}
+
+AffineTransform AffineTransform::rotationY(float angle)
+{
+    float sinTheta = std::sin(angle);
+    float cosTheta = std::cos(angle);
+    AffineTransform t;
+    t.m[0][0] = cosTheta;
+    t.m[0][2] = sinTheta;
+    t.m[2][0] = -sinTheta;
+    t.m[2][2] = cosTheta;
+    return t;
+}
+
+AffineTransform AffineTransform::operator*(const AffineTransform &other) const
+{
+    AffineTransform result;
+    for (int row = 0; row < 3; row++)
+    {
+        for (int col = 0; col < 4; col++)
+        {
+            float sum = col == 3 ? m[row][3] : 0.0f;
+            for (int k = 0; k < 3; k++)
+                sum += m[row][k] * other.m[k][col];
+            result.m[row][col] = sum;
+        }
+    }
+    return result;
+}
+
+float AffineTransform::determinant() const
+{
+    const auto &a = m;
+    return a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1]) + a[0][1] * (a[1][2] * a[2][0] - a[1][0] * a[2][2]) +
+           a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+}
+
+AffineTransform AffineTransform::inverse() const
+{
+    // Adjugate of the linear part over its determinant, then the translation mapped back through it
+    const auto &a = m;
+    float cofactor00 = a[1][1] * a[2][2] - a[1][2] * a[2][1];
+    float cofactor01 = a[1][2] * a[2][0] - a[1][0] * a[2][2];
+    float cofactor02 = a[1][0] * a[2][1] - a[1][1] * a[2][0];
+    float invDet = 1.0f / (a[0][0] * cofactor00 + a[0][1] * cofactor01 + a[0][2] * cofactor02);
+
+    AffineTransform result;
+    result.m[0][0] = cofactor00 * invDet;
+    result.m[1][0] = cofactor01 * invDet;
+    result.m[2][0] = cofactor02 * invDet;
+    result.m[0][1] = (a[0][2] * a[2][1] - a[0][1] * a[2][2]) * invDet;
+    result.m[1][1] = (a[0][0] * a[2][2] - a[0][2] * a[2][0]) * invDet;
+    result.m[2][1] = (a[0][1] * a[2][0] - a[0][0] * a[2][1]) * invDet;
+    result.m[0][2] = (a[0][1] * a[1][2] - a[0][2] * a[1][1]) * invDet;
+    result.m[1][2] = (a[0][2] * a[1][0] - a[0][0] * a[1][2]) * invDet;
+    result.m[2][2] = (a[0][0] * a[1][1] - a[0][1] * a[1][0]) * invDet;
+
+    glm::vec3 translation = -result.vector(glm::vec3(a[0][3], a[1][3], a[2][3]));
+    for (int row = 0; row < 3; row++)
+        result.m[row][3] = translation[row];
+    return result;
+}
+
+AABB AffineTransform::bounds(const AABB &box) const
+{
+    glm::vec3 min(INFINITY, INFINITY, INFINITY);
+    glm::vec3 max(-INFINITY, -INFINITY, -INFINITY);
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec3 corner(i & 1 ? box.x.max : box.x.min,
+                         i & 2 ? box.y.max : box.y.min,
+                         i & 4 ? box.z.max : box.z.min);
+        glm::vec3 transformed = point(corner);
+        min = glm::min(min, transformed);
+        max = glm::max(max, transformed);
+    }
+    return AABB(min, max);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include "bounding/aabb.h"
+
+// Affine transform stored as the top three rows of a row-major 4x4 matrix in float, the implicit last row
+// being (0, 0, 0, 1). Points use the translation column, vectors and normals only the linear part.
+struct AffineTransform
+{
+    float m[3][4] = {{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}};
+
+    static AffineTransform translation(const glm::vec3 &offset);
+    static AffineTransform scale(const glm::vec3 &factors);
+
+    // Rotation about the Y axis by angle radians, matching RotateY.
+    static AffineTransform rotationY(float angle);
+
+    // Composition applying other first, then this transform.
+    AffineTransform operator*(const AffineTransform &other) const;
+
+    // Determinant of the linear part, the factor the transform scales volumes by.
+    float determinant() const;
+
+    // Inverse transform, the linear part must not be singular.
+    AffineTransform inverse() const;
+
+    glm::vec3 point(const glm::vec3 &p) const
+    {
+        return glm::vec3(m[0][0] * p.x + m[0][1] * p.y + m[0][2] * p.z + m[0][3],
+                         m[1][0] * p.x + m[1][1] * p.y + m[1][2] * p.z + m[1][3],
+                         m[2][0] * p.x + m[2][1] * p.y + m[2][2] * p.z + m[2][3]);
+    }
+
+    glm::vec3 vector(const glm::vec3 &v) const
+    {
+        return glm::vec3(m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z,
+                         m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z,
+                         m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z);
+    }
+
+    // Multiplies by the transpose of the linear part. Called on the inverse transform this maps normals
+    // into the space of the forward transform, keeping them perpendicular under non-uniform scale.
+    glm::vec3 transposedVector(const glm::vec3 &n) const
+    {
+        return glm::vec3(m[0][0] * n.x + m[1][0] * n.y + m[2][0] * n.z,
+                         m[0][1] * n.x + m[1][1] * n.y + m[2][1] * n.z,
+                         m[0][2] * n.x + m[1][2] * n.y + m[2][2] * n.z);
+    }
+
+    // Bounds of the transformed corners of box.
+    AABB bounds(const AABB &box) const;
+};
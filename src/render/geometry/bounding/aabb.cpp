@@ -1,4 +1,5 @@
 #include "aabb.h"
+#include "stats/ray_stats.h"
 
 const AABB AABB::empty = AABB(Interval::empty, Interval::empty, Interval::empty);
 const AABB AABB::universe = AABB(Interval::universe, Interval::universe, Interval::universe);
@@ -49,6 +50,7 @@ int AABB::longestAxis() const
 
 bool AABB::hit(const Ray &ray, Interval rayInterval) const
 {
+    LUMI_STAT(aabbTests, 1);
     const glm::vec3 &rayOrigin = ray.origin();
     const glm::vec3 &rayDirection = ray.direction();
 
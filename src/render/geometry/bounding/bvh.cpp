@@ -1,82 +1,91 @@
 #include "bvh.h"
-#include <algorithm>
+#include "stats/profiler.h"
+#include <chrono>
 
-BVHNode::BVHNode(HittableList list) : BVHNode(list.objects, 0, list.objects.size())
+BVHNode::BVHNode(HittableList list, const BVHBuildOptions &options)
+    : width(options.width), objects(std::move(list.objects))
 {
+    std::vector<AABB> bounds;
+    bounds.reserve(objects.size());
+    for (const auto &object : objects)
+        bounds.push_back(object->boundingBox());
+
+    auto start = std::chrono::high_resolution_clock::now();
+    bvh = LinearBVH(bounds, options);
+    stats = bvh.buildStats;
+    finishBuild();
+    bbox = bvh.boundingBox();
+    auto end = std::chrono::high_resolution_clock::now();
+    stats.buildSeconds = std::chrono::duration<double>(end - start).count();
 }
 
-BVHNode::BVHNode(std::vector<std::shared_ptr<Hittable>> &objects, size_t start, size_t end)
+BVHRefitStats BVHNode::refit()
 {
-    bbox = AABB::empty;
-    for (size_t objectIndex = start; objectIndex < end; objectIndex++)
-        bbox = AABB(bbox, objects[objectIndex]->boundingBox());
+    std::vector<AABB> bounds;
+    bounds.reserve(objects.size());
+    for (const auto &object : objects)
+        bounds.push_back(object->boundingBox());
 
-    int axis = bbox.longestAxis();
+    auto start = std::chrono::high_resolution_clock::now();
+    BVHRefitStats refitStats = bvh.refit(bounds);
+    if (refitStats.rebuiltSubtrees > 0)
+        stats = bvh.buildStats;
+    finishBuild();
+    bbox = bvh.boundingBox();
+    auto end = std::chrono::high_resolution_clock::now();
+    refitStats.seconds = std::chrono::duration<double>(end - start).count();
+    return refitStats;
+}
 
-    auto comparator = boxXCompare;
-    if (axis == 1)
+void BVHNode::finishBuild()
+{
+    LUMI_PROFILE_SCOPE("BVH collapse");
+    // The wide layouts copy node bounds, so they are collapsed again even when only the bounds changed
+    if (width == 4)
     {
-        comparator = boxYCompare;
+        bvh4 = BVH4(bvh);
+        stats.nodeCount = bvh4.nodes.size();
     }
-    else if (axis == 2)
+    else if (width == 8)
     {
-        comparator = boxZCompare;
+        bvh8 = BVH8(bvh);
+        stats.nodeCount = bvh8.nodes.size();
     }
 
-    size_t objectSpan = end - start;
-
-    // TODO: optimise later and catch null nodes
-    if (objectSpan == 1)
-    {
-        left = right = objects[start];
-    }
-    else if (objectSpan == 2)
-    {
-        left = objects[start];
-        right = objects[start + 1];
-    }
-    else
-    {
-        // O(nlogn)
-        std::sort(std::begin(objects) + start, std::begin(objects) + end, comparator);
-        auto mid = start + objectSpan / 2;
-        left = std::make_shared<BVHNode>(objects, start, mid);
-        right = std::make_shared<BVHNode>(objects, mid, end);
-    }
+    // Compiled again after refits too, the arrays hold copies of the moved objects' geometry
+    primitives.clear();
+    leafPrimitives.clear();
+    leafPrimitives.reserve(objects.size());
+    for (uint32_t index : bvh.primitiveIndices)
+        leafPrimitives.push_back(primitives.add(objects[index]));
 }
 
 bool BVHNode::hit(const Ray &r, Interval ray_t, HitRecord &rec) const
 {
-    if (!bbox.hit(r, ray_t))
-        return false;
-
-    bool hitLeft = left->hit(r, ray_t, rec);
-    bool hitRight = right->hit(r, Interval(ray_t.min, hitLeft ? rec.t : ray_t.max), rec);
-
-    return hitLeft || hitRight;
-}
-
-AABB BVHNode::boundingBox() const { return bbox; }
-
-bool BVHNode::boxCompare(
-    const std::shared_ptr<Hittable> a, const std::shared_ptr<Hittable> b, int axis_index)
-{
-    auto aAxisInterval = a->boundingBox().getAxisInterval(axis_index);
-    auto bAxisInterval = b->boundingBox().getAxisInterval(axis_index);
-    return aAxisInterval.min < bAxisInterval.min;
-}
+    auto intersectLeaf = [&](uint32_t first, uint32_t count, Interval &rayT)
+    {
+        return hitLeaf(r, first, count, rayT, rec);
+    };
 
-bool BVHNode::boxXCompare(const std::shared_ptr<Hittable> a, const std::shared_ptr<Hittable> b)
-{
-    return boxCompare(a, b, 0);
+    if (width == 4)
+        return bvh4.traverse(r, ray_t, intersectLeaf);
+    if (width == 8)
+        return bvh8.traverse(r, ray_t, intersectLeaf);
+    return bvh.traverse(r, ray_t, intersectLeaf);
 }
 
-bool BVHNode::boxYCompare(const std::shared_ptr<Hittable> a, const std::shared_ptr<Hittable> b)
+bool BVHNode::hitLeaf(const Ray &r, uint32_t first, uint32_t count, Interval &rayT, HitRecord &rec) const
 {
-    return boxCompare(a, b, 1);
+    bool hitAnything = false;
+    for (uint32_t slot = first; slot < first + count; slot++)
+    {
+        if (primitives.hit(leafPrimitives[slot], r, rayT, rec))
+        {
+            hitAnything = true;
+            rayT.max = rec.t;
+        }
+    }
+    return hitAnything;
 }
 
-bool BVHNode::boxZCompare(const std::shared_ptr<Hittable> a, const std::shared_ptr<Hittable> b)
-{
-    return boxCompare(a, b, 2);
-}
\ No newline at end of file
+AABB BVHNode::boundingBox() const { return bbox; }
@@ -4,33 +4,45 @@
 #include "../hittable/hittable_list.h"
 #include "utils.h"
 #include "geometry/bounding/aabb.h"
-
-// BVHNode class represents a node in a Bounding Volume Hierarchy, used for efficient ray-object intersection.
-class BVHNode : public Hittable
+#include "geometry/bounding/linear_bvh.h"
+#include "geometry/bounding/wide_bvh.h"
+#include "geometry/objects/primitive_arrays.h"
+
+// BVHNode is the hittable front end of a flattened Bounding Volume Hierarchy, used for efficient ray-object intersection.
+// The hierarchy is a contiguous array of nodes, leaves index into the primitives reordered by the build.
+// With a build width of 4 or 8 the binary tree is collapsed and traversal uses the wide layout instead.
+// The objects are compiled into per-type primitive arrays in leaf order, leaves refer to them by (type, index).
+class BVHNode final : public Hittable
 {
 public:
-    // Constructs a BVHNode from a list of hittable objects.
-    explicit BVHNode(HittableList list);
-
-    // Constructs a BVHNode from a range of hittable objects.
-    BVHNode(std::vector<std::shared_ptr<Hittable>> &objects, size_t start, size_t end);
+    // Constructs a BVH from a list of hittable objects.
+    explicit BVHNode(HittableList list, const BVHBuildOptions &options = BVHBuildOptions());
 
     bool hit(const Ray &r, Interval ray_t, HitRecord &rec) const override;
 
-    // Returns the axis-aligned bounding box of the BVHNode.
+    // Returns the axis-aligned bounding box of the BVH.
     AABB boundingBox() const override;
 
+    // Build time and size of the hierarchy.
+    const BVHBuildStats &buildStats() const { return stats; }
+
+    // Refits the hierarchy after objects moved, rebuilding the parts whose quality degraded too far.
+    BVHRefitStats refit();
+
 private:
-    std::shared_ptr<Hittable> left;  // Left child
-    std::shared_ptr<Hittable> right; // Right child
-    AABB bbox;                       // Bounding box for the node
-
-    // Compares two hittable objects along a given axis (so we can sort them into left/right nodes).
-    static bool boxCompare(
-        const std::shared_ptr<Hittable> a, const std::shared_ptr<Hittable> b, int axis_index);
-
-    // Comparison functions for sorting along X, Y, Z axes.
-    static bool boxXCompare(const std::shared_ptr<Hittable> a, const std::shared_ptr<Hittable> b);
-    static bool boxYCompare(const std::shared_ptr<Hittable> a, const std::shared_ptr<Hittable> b);
-    static bool boxZCompare(const std::shared_ptr<Hittable> a, const std::shared_ptr<Hittable> b);
-};
\ No newline at end of file
+    // Collapses the binary tree into the wide layout and compiles the primitives in leaf slot order.
+    void finishBuild();
+
+    // Intersects the primitives in leaf slots [first, first + count), shrinking rayT.max on hits.
+    bool hitLeaf(const Ray &r, uint32_t first, uint32_t count, Interval &rayT, HitRecord &rec) const;
+
+    LinearBVH bvh;                                     // Flattened node array
+    BVH4 bvh4;                                         // Collapsed 4-wide nodes (width 4 only)
+    BVH8 bvh8;                                         // Collapsed 8-wide nodes (width 8 only)
+    int width;                                         // Layout used for traversal
+    BVHBuildStats stats;                               // Includes collapsing into the wide layout
+    std::vector<std::shared_ptr<Hittable>> objects;    // Objects in build input order
+    PrimitiveArrays primitives;                        // Compiled objects
+    std::vector<PrimitiveRef> leafPrimitives;          // Compiled object of each leaf slot
+    AABB bbox;                                         // Bounding box for the whole hierarchy
+};
@@ -0,0 +1,392 @@
+#include "bvh_builder.h"
+#include "parallel/thread_pool.h"
+#include <algorithm>
+
+BVHBuilder::BVHBuilder(const std::vector<AABB> &primitiveBounds, const BVHBuildOptions &options, int maxDepth)
+    : primitives(primitiveBounds.size()), options(options), maxDepth(maxDepth)
+{
+    // Leaves store their size in 16 bits
+    this->options.maxLeafSize = std::clamp(options.maxLeafSize, 1, 0xFFFF);
+    this->options.sahBinCount = std::max(options.sahBinCount, 2);
+    this->options.parallelThreshold = std::max<size_t>(options.parallelThreshold, 2);
+
+    for (size_t i = 0; i < primitiveBounds.size(); i++)
+    {
+        BVHBounds bounds(primitiveBounds[i]);
+        primitives[i] = {bounds, bounds.centroid(), static_cast<uint32_t>(i)};
+    }
+}
+
+void BVHBuilder::build(std::vector<LinearBVHNode> &nodes, std::vector<uint32_t> &primitiveIndices)
+{
+    nodes.clear();
+    primitiveIndices.clear();
+    if (primitives.empty())
+        return;
+
+    scratch.resize(primitives.size());
+    if (isParallel(0, primitives.size()))
+    {
+        nodes = buildParallel(0, primitives.size(), 0);
+    }
+    else
+    {
+        nodes.reserve(2 * primitives.size() - 1);
+        buildRecursive(nodes, 0, primitives.size(), 0);
+    }
+
+    primitiveIndices.resize(primitives.size());
+    for (size_t i = 0; i < primitives.size(); i++)
+        primitiveIndices[i] = primitives[i].index;
+}
+
+bool BVHBuilder::isParallel(size_t start, size_t end) const
+{
+    return options.pool != nullptr && options.pool->threadCount() > 1 && end - start >= options.parallelThreshold;
+}
+
+uint32_t BVHBuilder::buildRecursive(std::vector<LinearBVHNode> &nodes, size_t start, size_t end, int depth)
+{
+    auto nodeIndex = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+    Split split = splitRange(nodes[nodeIndex], start, end, depth);
+    if (split.mid == end)
+        return nodeIndex;
+
+    buildRecursive(nodes, start, split.mid, depth + 1);
+    nodes[nodeIndex].offset = buildRecursive(nodes, split.mid, end, depth + 1);
+    return nodeIndex;
+}
+
+std::vector<LinearBVHNode> BVHBuilder::buildParallel(size_t start, size_t end, int depth)
+{
+    std::vector<LinearBVHNode> nodes;
+    if (!isParallel(start, end))
+    {
+        nodes.reserve(2 * (end - start) - 1);
+        buildRecursive(nodes, start, end, depth);
+        return nodes;
+    }
+
+    LinearBVHNode node;
+    Split split = splitRange(node, start, end, depth);
+    if (split.mid == end)
+        return {node};
+
+    std::vector<LinearBVHNode> left;
+    std::vector<LinearBVHNode> right;
+    {
+        TaskGroup group(*options.pool);
+        group.run([&]() { left = buildParallel(start, split.mid, depth + 1); });
+        right = buildParallel(split.mid, end, depth + 1);
+        group.wait();
+    }
+
+    // Stitch the subtrees together behind their parent, shifting their interior child indices
+    nodes.reserve(1 + left.size() + right.size());
+    node.offset = static_cast<uint32_t>(1 + left.size());
+    nodes.push_back(node);
+    for (auto *subtree : {&left, &right})
+    {
+        auto base = static_cast<uint32_t>(nodes.size());
+        for (LinearBVHNode child : *subtree)
+        {
+            if (!child.isLeaf())
+                child.offset += base;
+            nodes.push_back(child);
+        }
+    }
+    return nodes;
+}
+
+BVHBuilder::Split BVHBuilder::splitRange(LinearBVHNode &node, size_t start, size_t end, int depth)
+{
+    BVHBounds bounds;
+    BVHBounds centroidBounds;
+    rangeBounds(start, end, bounds, centroidBounds);
+    node.setBounds(bounds);
+    node.pad = 0;
+
+    // An SAH split may peel off a single primitive, so close to maxDepth only median splits are sure to fit
+    bool nearDepthLimit = depth + 1 + LinearBVH::medianSplitDepth(end - start, options.maxLeafSize) > maxDepth;
+    Split split = options.splitMethod == BVHSplitMethod::SAH && !nearDepthLimit ? sahSplit(bounds, centroidBounds, start, end)
+                                                                                : medianSplit(bounds, start, end);
+    if (split.mid == end)
+    {
+        node.offset = static_cast<uint32_t>(start);
+        node.primitiveCount = static_cast<uint16_t>(end - start);
+        node.axis = 0;
+    }
+    else
+    {
+        // The second child's index is only known once the first subtree is built
+        node.offset = 0;
+        node.primitiveCount = 0;
+        node.axis = static_cast<uint8_t>(split.axis);
+    }
+    return split;
+}
+
+BVHBuilder::Split BVHBuilder::medianSplit(const BVHBounds &bounds, size_t start, size_t end)
+{
+    size_t span = end - start;
+    if (span <= static_cast<size_t>(options.maxLeafSize))
+        return {0, end};
+
+    // Order by box minimum with the primitive index as tie break, so the median is unique
+    int axis = bounds.longestAxis();
+    std::vector<std::pair<float, uint32_t>> keys(span);
+    for (size_t i = 0; i < span; i++)
+        keys[i] = {primitives[start + i].bounds.min[axis], primitives[start + i].index};
+    std::nth_element(keys.begin(), keys.begin() + span / 2, keys.end());
+    auto pivot = keys[span / 2];
+
+    auto onLeft = [axis, pivot](const BuildPrimitive &primitive)
+    {
+        return std::pair(primitive.bounds.min[axis], primitive.index) < pivot;
+    };
+    return {axis, partitionRange(start, end, onLeft)};
+}
+
+BVHBuilder::Split BVHBuilder::sahSplit(const BVHBounds &bounds, const BVHBounds &centroidBounds, size_t start, size_t end)
+{
+    size_t span = end - start;
+    if (span == 1)
+        return {0, end};
+
+    const int binCount = options.sahBinCount;
+    std::vector<Bin> bins(3 * binCount);
+    binRange(start, end, centroidBounds, bins);
+
+    std::vector<float> rightArea(binCount);
+    std::vector<size_t> rightCount(binCount);
+    float bestCost = INFINITY;
+    int bestAxis = -1;
+    int bestBin = 0;
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (centroidBounds.max[axis] - centroidBounds.min[axis] <= 0.0f)
+            continue;
+        const Bin *axisBins = &bins[axis * binCount];
+
+        // Sweep from the right to get the area and count on the far side of every plane
+        BVHBounds accumulated;
+        size_t count = 0;
+        for (int b = binCount - 1; b > 0; b--)
+        {
+            accumulated.grow(axisBins[b].bounds);
+            count += axisBins[b].count;
+            rightArea[b] = accumulated.surfaceArea();
+            rightCount[b] = count;
+        }
+
+        // Then from the left, evaluating the plane between bin b - 1 and bin b
+        accumulated = BVHBounds();
+        count = 0;
+        for (int b = 1; b < binCount; b++)
+        {
+            accumulated.grow(axisBins[b - 1].bounds);
+            count += axisBins[b - 1].count;
+            if (count == 0 || rightCount[b] == 0)
+                continue;
+
+            float cost = accumulated.surfaceArea() * count + rightArea[b] * rightCount[b];
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = b;
+            }
+        }
+    }
+
+    float parentArea = bounds.surfaceArea();
+    float leafCost = static_cast<float>(span);
+    bool fitsInLeaf = span <= static_cast<size_t>(options.maxLeafSize);
+
+    if (bestAxis < 0)
+    {
+        // Every centroid coincides, so no plane separates them
+        if (fitsInLeaf)
+            return {0, end};
+        size_t mid = start + span / 2;
+        return {bounds.longestAxis(), mid};
+    }
+
+    float splitCost = options.traversalCost + (parentArea > 0.0f ? bestCost / parentArea : leafCost);
+    if (fitsInLeaf && splitCost >= leafCost)
+        return {0, end};
+
+    float minCentroid = centroidBounds.min[bestAxis];
+    float scale = binScale(bestAxis, centroidBounds);
+    auto onLeft = [this, bestAxis, bestBin, minCentroid, scale](const BuildPrimitive &primitive)
+    {
+        return binIndex(primitive, bestAxis, minCentroid, scale) < bestBin;
+    };
+    return {bestAxis, partitionRange(start, end, onLeft)};
+}
+
+float BVHBuilder::binScale(int axis, const BVHBounds &centroidBounds) const
+{
+    return options.sahBinCount / (centroidBounds.max[axis] - centroidBounds.min[axis]);
+}
+
+int BVHBuilder::binIndex(const BuildPrimitive &primitive, int axis, float minCentroid, float scale) const
+{
+    int b = static_cast<int>((primitive.centroid[axis] - minCentroid) * scale);
+    return std::min(options.sahBinCount - 1, b);
+}
+
+template <typename Body>
+void BVHBuilder::forEachChunk(size_t start, size_t end, size_t chunkCount, Body &&body)
+{
+    size_t chunkSize = (end - start + chunkCount - 1) / chunkCount;
+    TaskGroup group(*options.pool);
+    for (size_t chunk = 0; chunk < chunkCount; chunk++)
+    {
+        size_t chunkStart = std::min(end, start + chunk * chunkSize);
+        size_t chunkEnd = std::min(end, chunkStart + chunkSize);
+        group.run([&body, chunk, chunkStart, chunkEnd]() { body(chunk, chunkStart, chunkEnd); });
+    }
+    group.wait();
+}
+
+void BVHBuilder::rangeBounds(size_t start, size_t end, BVHBounds &bounds, BVHBounds &centroidBounds)
+{
+    if (!isParallel(start, end))
+    {
+        for (size_t i = start; i < end; i++)
+        {
+            bounds.grow(primitives[i].bounds);
+            centroidBounds.grow(primitives[i].centroid);
+        }
+        return;
+    }
+
+    // Min/max reductions are exact, so merging the chunks in any order gives the serial result
+    size_t chunkCount = options.pool->threadCount();
+    std::vector<BVHBounds> chunkBounds(chunkCount);
+    std::vector<BVHBounds> chunkCentroids(chunkCount);
+    forEachChunk(start, end, chunkCount, [&](size_t chunk, size_t chunkStart, size_t chunkEnd)
+    {
+        for (size_t i = chunkStart; i < chunkEnd; i++)
+        {
+            chunkBounds[chunk].grow(primitives[i].bounds);
+            chunkCentroids[chunk].grow(primitives[i].centroid);
+        }
+    });
+    for (size_t chunk = 0; chunk < chunkCount; chunk++)
+    {
+        bounds.grow(chunkBounds[chunk]);
+        centroidBounds.grow(chunkCentroids[chunk]);
+    }
+}
+
+void BVHBuilder::binRange(size_t start, size_t end, const BVHBounds &centroidBounds, std::vector<Bin> &bins)
+{
+    const int binCount = options.sahBinCount;
+    auto binChunk = [&](std::vector<Bin> &target, size_t chunkStart, size_t chunkEnd)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (centroidBounds.max[axis] - centroidBounds.min[axis] <= 0.0f)
+                continue;
+            float minCentroid = centroidBounds.min[axis];
+            float scale = binScale(axis, centroidBounds);
+            for (size_t i = chunkStart; i < chunkEnd; i++)
+            {
+                Bin &bin = target[axis * binCount + binIndex(primitives[i], axis, minCentroid, scale)];
+                bin.bounds.grow(primitives[i].bounds);
+                bin.count++;
+            }
+        }
+    };
+
+    if (!isParallel(start, end))
+    {
+        binChunk(bins, start, end);
+        return;
+    }
+
+    size_t chunkCount = options.pool->threadCount();
+    std::vector<std::vector<Bin>> chunkBins(chunkCount, std::vector<Bin>(bins.size()));
+    forEachChunk(start, end, chunkCount, [&](size_t chunk, size_t chunkStart, size_t chunkEnd)
+    {
+        binChunk(chunkBins[chunk], chunkStart, chunkEnd);
+    });
+    for (size_t chunk = 0; chunk < chunkCount; chunk++)
+    {
+        for (size_t b = 0; b < bins.size(); b++)
+        {
+            bins[b].bounds.grow(chunkBins[chunk][b].bounds);
+            bins[b].count += chunkBins[chunk][b].count;
+        }
+    }
+}
+
+template <typename Predicate>
+size_t BVHBuilder::partitionRange(size_t start, size_t end, Predicate onLeft)
+{
+    if (!isParallel(start, end))
+    {
+        // Left side compacts in place, the right side waits in the scratch buffer
+        size_t left = start;
+        size_t right = start;
+        for (size_t i = start; i < end; i++)
+        {
+            if (onLeft(primitives[i]))
+                primitives[left++] = primitives[i];
+            else
+                scratch[right++] = primitives[i];
+        }
+        std::copy(scratch.begin() + start, scratch.begin() + right, primitives.begin() + left);
+        return left;
+    }
+
+    // Count each chunk's left side, then scatter through the scratch buffer in chunk order.
+    // That keeps the relative order within each side, matching the serial partition exactly.
+    size_t chunkCount = options.pool->threadCount();
+    std::vector<size_t> leftCounts(chunkCount, 0);
+    forEachChunk(start, end, chunkCount, [&](size_t chunk, size_t chunkStart, size_t chunkEnd)
+    {
+        for (size_t i = chunkStart; i < chunkEnd; i++)
+            leftCounts[chunk] += onLeft(primitives[i]) ? 1 : 0;
+    });
+
+    std::vector<size_t> leftOffsets(chunkCount);
+    std::vector<size_t> rightOffsets(chunkCount);
+    size_t leftTotal = 0;
+    for (size_t chunk = 0; chunk < chunkCount; chunk++)
+    {
+        leftOffsets[chunk] = start + leftTotal;
+        leftTotal += leftCounts[chunk];
+    }
+    size_t rightTotal = 0;
+    size_t chunkSize = (end - start + chunkCount - 1) / chunkCount;
+    for (size_t chunk = 0; chunk < chunkCount; chunk++)
+    {
+        size_t chunkStart = std::min(end, start + chunk * chunkSize);
+        size_t chunkEnd = std::min(end, chunkStart + chunkSize);
+        rightOffsets[chunk] = start + leftTotal + rightTotal;
+        rightTotal += (chunkEnd - chunkStart) - leftCounts[chunk];
+    }
+
+    forEachChunk(start, end, chunkCount, [&](size_t chunk, size_t chunkStart, size_t chunkEnd)
+    {
+        size_t left = leftOffsets[chunk];
+        size_t right = rightOffsets[chunk];
+        for (size_t i = chunkStart; i < chunkEnd; i++)
+        {
+            if (onLeft(primitives[i]))
+                scratch[left++] = primitives[i];
+            else
+                scratch[right++] = primitives[i];
+        }
+    });
+    forEachChunk(start, end, chunkCount, [&](size_t, size_t chunkStart, size_t chunkEnd)
+    {
+        std::copy(scratch.begin() + chunkStart, scratch.begin() + chunkEnd, primitives.begin() + chunkStart);
+    });
+    return start + leftTotal;
+}
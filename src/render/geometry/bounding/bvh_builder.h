@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "linear_bvh.h"
+
+// Top-down BVH builder producing the depth first node layout used by LinearBVH.
+// Given a thread pool, ranges above options.parallelThreshold are bounded, binned and partitioned
+// by all threads and their two subtrees are built as separate tasks. Every step is deterministic
+// (fixed chunking, stable partitions), so the parallel result is identical to the serial one.
+// No leaf ends up more than maxDepth levels below the root: ranges that could otherwise grow past it are
+// divided by median splits, which halve them.
+class BVHBuilder
+{
+public:
+    BVHBuilder(const std::vector<AABB> &primitiveBounds, const BVHBuildOptions &options, int maxDepth = LinearBVH::maxStackDepth);
+
+    // Builds the hierarchy, replacing the contents of nodes and primitiveIndices.
+    void build(std::vector<LinearBVHNode> &nodes, std::vector<uint32_t> &primitiveIndices);
+
+private:
+    struct BuildPrimitive
+    {
+        BVHBounds bounds;
+        glm::vec3 centroid;
+        uint32_t index;
+    };
+
+    // Where to divide a range of primitives, mid == end means the range becomes a leaf.
+    struct Split
+    {
+        int axis;
+        size_t mid;
+    };
+
+    struct Bin
+    {
+        BVHBounds bounds;
+        size_t count = 0;
+    };
+
+    // Appends the subtree over primitives [start, end) rooted at depth and returns the index of its root.
+    uint32_t buildRecursive(std::vector<LinearBVHNode> &nodes, size_t start, size_t end, int depth);
+
+    // Builds the subtree over [start, end) with node indices relative to its root, in parallel when large.
+    std::vector<LinearBVHNode> buildParallel(size_t start, size_t end, int depth);
+
+    // Fills in a node at depth for the range, partitions the primitives and returns the chosen split.
+    Split splitRange(LinearBVHNode &node, size_t start, size_t end, int depth);
+
+    Split medianSplit(const BVHBounds &bounds, size_t start, size_t end);
+
+    // Bins primitive centroids along each axis and picks the plane with the lowest SAH cost,
+    // or a leaf when no split is cheaper than intersecting every primitive.
+    Split sahSplit(const BVHBounds &bounds, const BVHBounds &centroidBounds, size_t start, size_t end);
+
+    // Bounds of the primitives and of their centroids over a range.
+    void rangeBounds(size_t start, size_t end, BVHBounds &bounds, BVHBounds &centroidBounds);
+
+    // Counts primitives per bin for all three axes (bins[axis * binCount + b]).
+    void binRange(size_t start, size_t end, const BVHBounds &centroidBounds, std::vector<Bin> &bins);
+
+    // Stable partition of [start, end), returns the first index for which onLeft is false.
+    template <typename Predicate>
+    size_t partitionRange(size_t start, size_t end, Predicate onLeft);
+
+    // Runs body(chunk, chunkStart, chunkEnd) over fixed chunks of [start, end) on the pool.
+    template <typename Body>
+    void forEachChunk(size_t start, size_t end, size_t chunkCount, Body &&body);
+
+    bool isParallel(size_t start, size_t end) const;
+    // Scale maps centroid offsets along an axis to bin indices.
+    float binScale(int axis, const BVHBounds &centroidBounds) const;
+    int binIndex(const BuildPrimitive &primitive, int axis, float minCentroid, float scale) const;
+
+    std::vector<BuildPrimitive> primitives;
+    std::vector<BuildPrimitive> scratch; // Partition buffer, ranges of concurrent subtrees never overlap
+    BVHBuildOptions options;
+    int maxDepth;
+};
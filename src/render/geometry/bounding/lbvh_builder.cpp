@@ -0,0 +1,363 @@
+#include "lbvh_builder.h"
+#include "parallel/thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+
+namespace
+{
+    // Spreads the low 21 bits of v so that two zero bits follow each of them.
+    uint64_t expandBits(uint64_t v)
+    {
+        v &= 0x1FFFFF;
+        v = (v | v << 32) & 0x1F00000000FFFFull;
+        v = (v | v << 16) & 0x1F0000FF0000FFull;
+        v = (v | v << 8) & 0x100F00F00F00F00Full;
+        v = (v | v << 4) & 0x10C30C30C30C30C3ull;
+        v = (v | v << 2) & 0x1249249249249249ull;
+        return v;
+    }
+
+    LinearBVHNode leafNode(const BVHBounds &box, uint32_t first, uint32_t count)
+    {
+        LinearBVHNode node;
+        node.setBounds(box);
+        node.offset = first;
+        node.primitiveCount = static_cast<uint16_t>(count);
+        node.axis = 0;
+        node.pad = 0;
+        return node;
+    }
+}
+
+LBVHBuilder::LBVHBuilder(const std::vector<AABB> &primitiveBounds, const BVHBuildOptions &options, int maxDepth)
+    : bounds(primitiveBounds.size()), options(options), maxDepth(maxDepth)
+{
+    this->options.maxLeafSize = std::clamp(options.maxLeafSize, 1, 0xFFFF);
+    this->options.mortonBits = options.mortonBits > 30 ? 63 : 30;
+    for (size_t i = 0; i < primitiveBounds.size(); i++)
+        bounds[i] = BVHBounds(primitiveBounds[i]);
+}
+
+void LBVHBuilder::build(std::vector<LinearBVHNode> &nodes, std::vector<uint32_t> &primitiveIndices)
+{
+    nodes.clear();
+    primitiveIndices.clear();
+    if (bounds.empty())
+        return;
+
+    computeMortonCodes();
+    sortByMortonCode();
+    emitRadixTree();
+    fitBounds();
+    flatten(nodes);
+    primitiveIndices = order;
+}
+
+size_t LBVHBuilder::chunkCount(size_t count) const
+{
+    if (options.pool == nullptr || count < options.parallelThreshold)
+        return 1;
+    return options.pool->threadCount();
+}
+
+template <typename Body>
+void LBVHBuilder::parallelChunks(size_t count, Body &&body) const
+{
+    size_t chunks = chunkCount(count);
+    size_t chunkSize = (count + chunks - 1) / chunks;
+    if (chunks == 1)
+    {
+        body(size_t(0), size_t(0), count);
+        return;
+    }
+
+    TaskGroup group(*options.pool);
+    for (size_t chunk = 0; chunk < chunks; chunk++)
+    {
+        size_t begin = std::min(count, chunk * chunkSize);
+        size_t end = std::min(count, begin + chunkSize);
+        group.run([&body, chunk, begin, end]() { body(chunk, begin, end); });
+    }
+    group.wait();
+}
+
+void LBVHBuilder::computeMortonCodes()
+{
+    size_t n = bounds.size();
+    BVHBounds centroidBounds;
+    for (const auto &box : bounds)
+        centroidBounds.grow(box.centroid());
+
+    const uint64_t resolution = 1ull << (options.mortonBits / 3);
+    glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+    glm::vec3 scale;
+    for (int axis = 0; axis < 3; axis++)
+        scale[axis] = extent[axis] > 0.0f ? static_cast<float>(resolution - 1) / extent[axis] : 0.0f;
+
+    codes.resize(n);
+    order.resize(n);
+    parallelChunks(n, [&](size_t, size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            glm::vec3 cell = (bounds[i].centroid() - centroidBounds.min) * scale;
+            codes[i] = (expandBits(static_cast<uint64_t>(cell.x)) << 2) |
+                       (expandBits(static_cast<uint64_t>(cell.y)) << 1) |
+                       expandBits(static_cast<uint64_t>(cell.z));
+            order[i] = static_cast<uint32_t>(i);
+        }
+    });
+}
+
+void LBVHBuilder::sortByMortonCode()
+{
+    // Least significant digit radix sort, 8 bits per pass. Each chunk histograms its keys, then scatters
+    // them to offsets computed digit by digit and chunk by chunk, which keeps every pass stable.
+    size_t n = codes.size();
+    size_t chunks = chunkCount(n);
+
+    std::vector<uint64_t> codesOut(n);
+    std::vector<uint32_t> orderOut(n);
+    std::vector<size_t> histograms(chunks * 256);
+
+    for (int shift = 0; shift < options.mortonBits; shift += 8)
+    {
+        std::fill(histograms.begin(), histograms.end(), 0);
+        parallelChunks(n, [&](size_t chunk, size_t begin, size_t end)
+        {
+            size_t *histogram = &histograms[chunk * 256];
+            for (size_t i = begin; i < end; i++)
+                histogram[(codes[i] >> shift) & 0xFF]++;
+        });
+
+        size_t offset = 0;
+        for (size_t digit = 0; digit < 256; digit++)
+        {
+            for (size_t chunk = 0; chunk < chunks; chunk++)
+            {
+                size_t count = histograms[chunk * 256 + digit];
+                histograms[chunk * 256 + digit] = offset;
+                offset += count;
+            }
+        }
+
+        parallelChunks(n, [&](size_t chunk, size_t begin, size_t end)
+        {
+            size_t *offsets = &histograms[chunk * 256];
+            for (size_t i = begin; i < end; i++)
+            {
+                size_t destination = offsets[(codes[i] >> shift) & 0xFF]++;
+                codesOut[destination] = codes[i];
+                orderOut[destination] = order[i];
+            }
+        });
+        codes.swap(codesOut);
+        order.swap(orderOut);
+    }
+}
+
+int LBVHBuilder::commonPrefix(int64_t i, int64_t j) const
+{
+    if (j < 0 || j >= static_cast<int64_t>(codes.size()))
+        return -1;
+    uint64_t a = codes[i];
+    uint64_t b = codes[j];
+    if (a == b)
+        return 64 + std::countl_zero(static_cast<uint32_t>(i ^ j));
+    return std::countl_zero(a ^ b);
+}
+
+void LBVHBuilder::emitRadixTree()
+{
+    auto n = static_cast<int64_t>(codes.size());
+    internal.assign(n > 1 ? n - 1 : 0, RadixNode());
+    leafParent.assign(n, 0);
+    if (n == 1)
+        return;
+
+    internal[0].parent = 0;
+    parallelChunks(static_cast<size_t>(n - 1), [&](size_t, size_t begin, size_t end)
+    {
+        for (auto i = static_cast<int64_t>(begin); i < static_cast<int64_t>(end); i++)
+        {
+            // The node covers a range starting at i and extending towards the neighbour sharing the longer prefix
+            int direction = commonPrefix(i, i + 1) - commonPrefix(i, i - 1) >= 0 ? 1 : -1;
+            int minPrefix = commonPrefix(i, i - direction);
+
+            int64_t maxLength = 2;
+            while (commonPrefix(i, i + maxLength * direction) > minPrefix)
+                maxLength *= 2;
+            int64_t length = 0;
+            for (int64_t step = maxLength / 2; step >= 1; step /= 2)
+            {
+                if (commonPrefix(i, i + (length + step) * direction) > minPrefix)
+                    length += step;
+            }
+            int64_t j = i + length * direction;
+
+            // Binary search for the last position sharing more than the node's prefix
+            int nodePrefix = commonPrefix(i, j);
+            int64_t split = 0;
+            int64_t step = length;
+            do
+            {
+                step = (step + 1) / 2;
+                if (commonPrefix(i, i + (split + step) * direction) > nodePrefix)
+                    split += step;
+            } while (step > 1);
+            int64_t gamma = i + split * direction + std::min(direction, 0);
+
+            RadixNode &node = internal[i];
+            node.first = static_cast<uint32_t>(std::min(i, j));
+            node.last = static_cast<uint32_t>(std::max(i, j));
+
+            // The highest differing bit is the split plane, codes interleave x, y, z from the top
+            int differingBit = 63 - nodePrefix;
+            node.axis = differingBit >= 0 ? static_cast<uint8_t>(2 - differingBit % 3) : 0;
+
+            auto left = static_cast<uint32_t>(gamma);
+            auto right = static_cast<uint32_t>(gamma + 1);
+            if (node.first == left)
+            {
+                node.children[0] = left | leafFlag;
+                leafParent[left] = static_cast<uint32_t>(i);
+            }
+            else
+            {
+                node.children[0] = left;
+                internal[left].parent = static_cast<uint32_t>(i);
+            }
+            if (node.last == right)
+            {
+                node.children[1] = right | leafFlag;
+                leafParent[right] = static_cast<uint32_t>(i);
+            }
+            else
+            {
+                node.children[1] = right;
+                internal[right].parent = static_cast<uint32_t>(i);
+            }
+        }
+    });
+}
+
+void LBVHBuilder::fitBounds()
+{
+    size_t n = codes.size();
+    if (n == 1)
+        return;
+
+    std::vector<std::atomic<uint32_t>> arrivals(internal.size());
+    auto childBounds = [this](uint32_t child)
+    {
+        return (child & leafFlag) ? bounds[order[child & ~leafFlag]] : internal[child].bounds;
+    };
+
+    parallelChunks(n, [&](size_t, size_t begin, size_t end)
+    {
+        for (size_t leaf = begin; leaf < end; leaf++)
+        {
+            uint32_t current = leafParent[leaf];
+            while (true)
+            {
+                // The first child to arrive stops, the second has both children's bounds available
+                if (arrivals[current].fetch_add(1, std::memory_order_acq_rel) == 0)
+                    break;
+
+                RadixNode &node = internal[current];
+                node.bounds = childBounds(node.children[0]);
+                node.bounds.grow(childBounds(node.children[1]));
+                if (current == 0)
+                    break;
+                current = node.parent;
+            }
+        }
+    });
+}
+
+void LBVHBuilder::flatten(std::vector<LinearBVHNode> &nodes) const
+{
+    struct Pending
+    {
+        uint32_t ref;
+        int64_t parent; // Node waiting for this subtree's index as its second child, -1 for first children
+        int depth;
+    };
+
+    nodes.reserve(2 * codes.size() - 1);
+    std::vector<Pending> stack;
+    stack.push_back({codes.size() == 1 ? leafFlag : 0u, -1, 0});
+    while (!stack.empty())
+    {
+        Pending pending = stack.back();
+        stack.pop_back();
+
+        auto index = static_cast<uint32_t>(nodes.size());
+        if (pending.parent >= 0)
+            nodes[pending.parent].offset = index;
+
+        if (pending.ref & leafFlag)
+        {
+            uint32_t slot = pending.ref & ~leafFlag;
+            nodes.push_back(leafNode(bounds[order[slot]], slot, 1));
+            continue;
+        }
+
+        const RadixNode &radix = internal[pending.ref];
+        uint32_t count = radix.last - radix.first + 1;
+        if (count <= static_cast<uint32_t>(options.maxLeafSize))
+        {
+            nodes.push_back(leafNode(radix.bounds, radix.first, count));
+            continue;
+        }
+
+        // Duplicate codes fall back to index bits, so radix trees can be far deeper than the key length.
+        // Close to maxDepth the range is split at its median along the curve instead, which always fits.
+        if (pending.depth + 1 + LinearBVH::medianSplitDepth(count, options.maxLeafSize) > maxDepth)
+        {
+            flattenMedian(nodes, radix.first, radix.last + 1);
+            continue;
+        }
+
+        LinearBVHNode node;
+        node.setBounds(radix.bounds);
+        node.offset = 0;
+        node.primitiveCount = 0;
+        node.axis = radix.axis;
+        node.pad = 0;
+        nodes.push_back(node);
+
+        // First child directly follows its parent, so it is popped first
+        stack.push_back({radix.children[1], index, pending.depth + 1});
+        stack.push_back({radix.children[0], -1, pending.depth + 1});
+    }
+}
+
+void LBVHBuilder::flattenMedian(std::vector<LinearBVHNode> &nodes, uint32_t first, uint32_t end) const
+{
+    BVHBounds box;
+    for (uint32_t slot = first; slot < end; slot++)
+        box.grow(bounds[order[slot]]);
+
+    uint32_t count = end - first;
+    if (count <= static_cast<uint32_t>(options.maxLeafSize))
+    {
+        nodes.push_back(leafNode(box, first, count));
+        return;
+    }
+
+    auto index = static_cast<uint32_t>(nodes.size());
+    LinearBVHNode node;
+    node.setBounds(box);
+    node.offset = 0;
+    node.primitiveCount = 0;
+    node.axis = static_cast<uint8_t>(box.longestAxis());
+    node.pad = 0;
+    nodes.push_back(node);
+
+    uint32_t mid = first + count / 2;
+    flattenMedian(nodes, first, mid);
+    nodes[index].offset = static_cast<uint32_t>(nodes.size());
+    flattenMedian(nodes, mid, end);
+}
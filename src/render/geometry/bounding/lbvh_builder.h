@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "linear_bvh.h"
+
+// Linear BVH builder (Karras 2012). Primitive centroids are sorted along a Morton curve with a parallel
+// radix sort, every internal node of the resulting radix tree is emitted independently and bounds are
+// then fitted bottom up. Builds far faster than the SAH builder at the cost of some tree quality,
+// the output uses the same depth first layout as every other LinearBVH. Subtrees that would reach past
+// maxDepth are split at their median along the curve instead.
+class LBVHBuilder
+{
+public:
+    LBVHBuilder(const std::vector<AABB> &primitiveBounds, const BVHBuildOptions &options, int maxDepth = LinearBVH::maxStackDepth);
+
+    // Builds the hierarchy, replacing the contents of nodes and primitiveIndices.
+    void build(std::vector<LinearBVHNode> &nodes, std::vector<uint32_t> &primitiveIndices);
+
+private:
+    // Child references of radix tree nodes have this bit set when they point at a leaf (a sorted primitive).
+    static constexpr uint32_t leafFlag = 0x80000000;
+
+    struct RadixNode
+    {
+        BVHBounds bounds;
+        uint32_t children[2];
+        uint32_t parent;
+        uint32_t first; // Range of sorted primitives below this node
+        uint32_t last;
+        uint8_t axis;
+    };
+
+    void computeMortonCodes();
+    void sortByMortonCode();
+
+    // Finds the primitive range and split of every internal node.
+    void emitRadixTree();
+
+    // Fits bounds from the leaves upwards, the second child to finish computes its parent.
+    void fitBounds();
+
+    // Writes the radix tree depth first, turning subtrees of at most maxLeafSize primitives into leaves.
+    void flatten(std::vector<LinearBVHNode> &nodes) const;
+
+    // Appends a subtree over sorted slots [first, end) that halves the range at every level.
+    void flattenMedian(std::vector<LinearBVHNode> &nodes, uint32_t first, uint32_t end) const;
+
+    // Length of the common prefix of the sorted codes i and j, -1 outside the array.
+    // Duplicate codes fall back to comparing indices so the tree stays well defined.
+    int commonPrefix(int64_t i, int64_t j) const;
+
+    // Number of chunks parallelChunks splits count items into, one unless the pool is used.
+    size_t chunkCount(size_t count) const;
+
+    // Runs body(chunk, begin, end) over chunks of [0, count) on the pool, or inline when the range is small.
+    template <typename Body>
+    void parallelChunks(size_t count, Body &&body) const;
+
+    std::vector<BVHBounds> bounds;
+    std::vector<uint64_t> codes;    // Sorted Morton codes
+    std::vector<uint32_t> order;    // Primitive index of each sorted code
+    std::vector<RadixNode> internal; // n - 1 internal nodes, the root is internal[0]
+    std::vector<uint32_t> leafParent;
+    BVHBuildOptions options;
+    int maxDepth;
+};
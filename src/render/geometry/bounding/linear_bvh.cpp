@@ -0,0 +1,324 @@
+#include "linear_bvh.h"
+#include "bvh_builder.h"
+#include "lbvh_builder.h"
+#include "stats/profiler.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <functional>
+
+BVHBounds::BVHBounds(const AABB &box)
+    : min(box.x.min, box.y.min, box.z.min), max(box.x.max, box.y.max, box.z.max)
+{
+}
+
+void BVHBounds::grow(const glm::vec3 &point)
+{
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+}
+
+void BVHBounds::grow(const BVHBounds &other)
+{
+    min = glm::min(min, other.min);
+    max = glm::max(max, other.max);
+}
+
+float BVHBounds::surfaceArea() const
+{
+    glm::vec3 extent = max - min;
+    if (extent.x < 0 || extent.y < 0 || extent.z < 0)
+        return 0.0f;
+    return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
+int BVHBounds::longestAxis() const
+{
+    glm::vec3 extent = max - min;
+    if (extent.x > extent.y)
+        return extent.x > extent.z ? 0 : 2;
+    else
+        return extent.y > extent.z ? 1 : 2;
+}
+
+AABB BVHBounds::toAABB() const
+{
+    return AABB(Interval(min.x, max.x), Interval(min.y, max.y), Interval(min.z, max.z));
+}
+
+BVHBounds LinearBVHNode::bounds() const
+{
+    BVHBounds box;
+    box.min = glm::vec3(boundsMin[0], boundsMin[1], boundsMin[2]);
+    box.max = glm::vec3(boundsMax[0], boundsMax[1], boundsMax[2]);
+    return box;
+}
+
+void LinearBVHNode::setBounds(const BVHBounds &bounds)
+{
+    for (int axis = 0; axis < 3; axis++)
+    {
+        boundsMin[axis] = bounds.min[axis];
+        boundsMax[axis] = bounds.max[axis];
+    }
+}
+
+BVHRay::BVHRay(const Ray &r) : origin(r.origin())
+{
+    for (int axis = 0; axis < 3; axis++)
+    {
+        invDirection[axis] = 1.0f / r.direction()[axis];
+        dirIsNeg[axis] = invDirection[axis] < 0;
+    }
+}
+
+LinearBVH::LinearBVH(const std::vector<AABB> &primitiveBounds, const BVHBuildOptions &options)
+    : options(options)
+{
+    build(primitiveBounds);
+}
+
+void LinearBVH::build(const std::vector<AABB> &primitiveBounds)
+{
+    LUMI_PROFILE_SCOPE("BVH build");
+    auto start = std::chrono::high_resolution_clock::now();
+    if (options.splitMethod == BVHSplitMethod::LBVH)
+        LBVHBuilder(primitiveBounds, options).build(nodes, primitiveIndices);
+    else
+        BVHBuilder(primitiveBounds, options).build(nodes, primitiveIndices);
+    // Builders reserve for the worst case of one primitive per leaf
+    nodes.shrink_to_fit();
+    auto end = std::chrono::high_resolution_clock::now();
+    updateBuildStats(std::chrono::duration<double>(end - start).count());
+
+    // Both builders keep the depth within what the traversal stack holds
+    assert(buildStats.depth <= maxStackDepth);
+
+    builtCost = subtreeCosts();
+}
+
+void LinearBVH::updateBuildStats(double buildSeconds)
+{
+    buildStats = BVHBuildStats();
+    buildStats.buildSeconds = buildSeconds;
+    buildStats.nodeCount = nodes.size();
+    buildStats.primitiveCount = primitiveIndices.size();
+    for (const auto &node : nodes)
+        buildStats.leafCount += node.isLeaf() ? 1 : 0;
+    std::vector<int> depths = nodeDepths();
+    buildStats.depth = depths.empty() ? 0 : *std::max_element(depths.begin(), depths.end());
+}
+
+int LinearBVH::medianSplitDepth(size_t primitiveCount, int maxLeafSize)
+{
+    int depth = 0;
+    for (size_t count = primitiveCount; count > static_cast<size_t>(std::max(maxLeafSize, 1)); count = (count + 1) / 2)
+        depth++;
+    return depth;
+}
+
+AABB LinearBVH::boundingBox() const
+{
+    if (nodes.empty())
+        return AABB::empty;
+    return nodes.front().bounds().toAABB();
+}
+
+std::vector<float> LinearBVH::subtreeCosts() const
+{
+    std::vector<float> costs(nodes.size());
+    for (size_t i = nodes.size(); i-- > 0;)
+    {
+        const LinearBVHNode &node = nodes[i];
+        float area = node.bounds().surfaceArea();
+        if (node.isLeaf())
+            costs[i] = area * node.primitiveCount;
+        else
+            costs[i] = area * options.traversalCost + costs[i + 1] + costs[node.offset];
+    }
+    return costs;
+}
+
+std::vector<uint32_t> LinearBVH::subtreeEnds() const
+{
+    std::vector<uint32_t> ends(nodes.size());
+    for (size_t i = nodes.size(); i-- > 0;)
+        ends[i] = nodes[i].isLeaf() ? static_cast<uint32_t>(i + 1) : ends[nodes[i].offset];
+    return ends;
+}
+
+std::vector<int> LinearBVH::nodeDepths() const
+{
+    // Parents come before their children, so a forward sweep sets every depth before it is read
+    std::vector<int> depths(nodes.size(), 0);
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        if (!nodes[i].isLeaf())
+            depths[i + 1] = depths[nodes[i].offset] = depths[i] + 1;
+    }
+    return depths;
+}
+
+float LinearBVH::sahCost() const
+{
+    if (nodes.empty())
+        return 0.0f;
+    float rootArea = nodes.front().bounds().surfaceArea();
+    return rootArea > 0.0f ? subtreeCosts().front() / rootArea : 0.0f;
+}
+
+BVHRefitStats LinearBVH::refit(const std::vector<AABB> &primitiveBounds)
+{
+    LUMI_PROFILE_SCOPE("BVH refit");
+    auto start = std::chrono::high_resolution_clock::now();
+    BVHRefitStats stats;
+    if (nodes.empty())
+        return stats;
+
+    // Children come after their parent in the array, so a reverse sweep sees them first
+    for (size_t i = nodes.size(); i-- > 0;)
+    {
+        LinearBVHNode &node = nodes[i];
+        BVHBounds bounds;
+        if (node.isLeaf())
+        {
+            for (uint32_t slot = node.offset; slot < node.offset + node.primitiveCount; slot++)
+                bounds.grow(BVHBounds(primitiveBounds[primitiveIndices[slot]]));
+        }
+        else
+        {
+            bounds = nodes[i + 1].bounds();
+            bounds.grow(nodes[node.offset].bounds());
+        }
+        node.setBounds(bounds);
+    }
+
+    std::vector<float> costs = subtreeCosts();
+    stats.costRatio = builtCost[0] > 0.0f ? costs[0] / builtCost[0] : 1.0f;
+    // Restructuring cannot improve a single leaf, so only interior nodes count as degraded
+    auto isDegraded = [&](uint32_t node)
+    {
+        return !nodes[node].isLeaf() && costs[node] > options.refitRebuildThreshold * builtCost[node];
+    };
+
+    if (isDegraded(0))
+    {
+        // Find the subtrees to rebuild top down. A degraded subtree holding at most half of the primitives is
+        // rebuilt on its own, a larger one only when the degradation is not explained by one of its children.
+        std::vector<uint32_t> ends = subtreeEnds();
+        std::vector<uint32_t> rebuildRoots;
+        std::vector<uint32_t> pending = {0};
+        while (!pending.empty())
+        {
+            uint32_t node = pending.back();
+            pending.pop_back();
+            if (!isDegraded(node))
+                continue;
+
+            const LinearBVHNode &current = nodes[node];
+            uint32_t firstLeaf = node;
+            while (!nodes[firstLeaf].isLeaf())
+                firstLeaf++;
+            const LinearBVHNode &lastLeaf = nodes[ends[node] - 1];
+            size_t primitiveCount = lastLeaf.offset + lastLeaf.primitiveCount - nodes[firstLeaf].offset;
+
+            bool small = primitiveCount * 2 <= primitiveIndices.size();
+            bool childDegraded = isDegraded(node + 1) || isDegraded(current.offset);
+            if (small || !childDegraded)
+            {
+                rebuildRoots.push_back(node);
+                continue;
+            }
+            pending.push_back(node + 1);
+            pending.push_back(current.offset);
+        }
+
+        if (!rebuildRoots.empty() && rebuildRoots.front() == 0)
+        {
+            build(primitiveBounds);
+            stats.fullRebuild = true;
+            stats.rebuiltSubtrees = 1;
+        }
+        else
+        {
+            // Splice from the back so the positions of subtrees still to be rebuilt do not move. Each subtree
+            // may only use the levels left below its root.
+            std::vector<int> depths = nodeDepths();
+            std::vector<bool> rebuilt(nodes.size(), false);
+            std::sort(rebuildRoots.begin(), rebuildRoots.end(), std::greater<>());
+            for (uint32_t root : rebuildRoots)
+            {
+                uint32_t size = rebuildSubtree(root, ends[root], primitiveBounds, maxStackDepth - depths[root]);
+                rebuilt.erase(rebuilt.begin() + root, rebuilt.begin() + ends[root]);
+                rebuilt.insert(rebuilt.begin() + root, size, true);
+                costs.erase(costs.begin() + root, costs.begin() + ends[root]);
+                costs.insert(costs.begin() + root, size, 0.0f);
+            }
+            stats.rebuiltSubtrees = rebuildRoots.size();
+            updateBuildStats(buildStats.buildSeconds);
+
+            // A subtree too large to fit below its root leaves the tree too deep, then rebuild it whole
+            if (buildStats.depth > maxStackDepth)
+            {
+                build(primitiveBounds);
+                stats.fullRebuild = true;
+            }
+            else
+            {
+                // Rebuilt subtrees start from their new cost. Every other node keeps the baseline of its last
+                // build, shifted by what the rebuilds below it saved, so degradation that stayed under the
+                // threshold still adds up over later refits instead of being forgiven.
+                std::vector<float> rebuiltCosts = subtreeCosts();
+                for (size_t i = 0; i < nodes.size(); i++)
+                    builtCost[i] = rebuilt[i] ? rebuiltCosts[i] : builtCost[i] + rebuiltCosts[i] - costs[i];
+            }
+        }
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    stats.seconds = std::chrono::duration<double>(end - start).count();
+    return stats;
+}
+
+uint32_t LinearBVH::rebuildSubtree(uint32_t root, uint32_t end, const std::vector<AABB> &primitiveBounds, int maxDepth)
+{
+    // Leaves of a subtree cover one contiguous run of primitive slots
+    uint32_t firstLeaf = root;
+    while (!nodes[firstLeaf].isLeaf())
+        firstLeaf++;
+    uint32_t firstSlot = nodes[firstLeaf].offset;
+    uint32_t endSlot = nodes[end - 1].offset + nodes[end - 1].primitiveCount;
+
+    std::vector<AABB> subsetBounds;
+    subsetBounds.reserve(endSlot - firstSlot);
+    for (uint32_t slot = firstSlot; slot < endSlot; slot++)
+        subsetBounds.push_back(primitiveBounds[primitiveIndices[slot]]);
+
+    std::vector<LinearBVHNode> subtree;
+    std::vector<uint32_t> subsetOrder;
+    if (options.splitMethod == BVHSplitMethod::LBVH)
+        LBVHBuilder(subsetBounds, options, maxDepth).build(subtree, subsetOrder);
+    else
+        BVHBuilder(subsetBounds, options, maxDepth).build(subtree, subsetOrder);
+
+    std::vector<uint32_t> previousIndices(primitiveIndices.begin() + firstSlot, primitiveIndices.begin() + endSlot);
+    for (size_t i = 0; i < subsetOrder.size(); i++)
+        primitiveIndices[firstSlot + i] = previousIndices[subsetOrder[i]];
+
+    for (auto &node : subtree)
+        node.offset += node.isLeaf() ? firstSlot : root;
+
+    // Nodes outside the subtree that point past it shift by the change in its size
+    auto delta = static_cast<int64_t>(subtree.size()) - static_cast<int64_t>(end - root);
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        if ((i < root || i >= end) && !nodes[i].isLeaf() && nodes[i].offset >= end)
+            nodes[i].offset = static_cast<uint32_t>(nodes[i].offset + delta);
+    }
+
+    nodes.erase(nodes.begin() + root, nodes.begin() + end);
+    nodes.insert(nodes.begin() + root, subtree.begin(), subtree.end());
+    builtCost.erase(builtCost.begin() + root, builtCost.begin() + end);
+    builtCost.insert(builtCost.begin() + root, subtree.size(), 0.0f);
+    return static_cast<uint32_t>(subtree.size());
+}
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "aabb.h"
+#include "../ray.h"
+#include "../interval.h"
+#include "stats/ray_stats.h"
+
+class ThreadPool;
+
+// Single precision box used while building and traversing flattened BVHs.
+struct BVHBounds
+{
+    glm::vec3 min = glm::vec3(INFINITY);
+    glm::vec3 max = glm::vec3(-INFINITY);
+
+    BVHBounds() = default;
+    explicit BVHBounds(const AABB &box);
+
+    void grow(const glm::vec3 &point);
+    void grow(const BVHBounds &other);
+
+    glm::vec3 centroid() const { return 0.5f * (min + max); }
+    float surfaceArea() const;
+
+    // Returns the index of the longest axis (0 = x, 1 = y, 2 = z).
+    int longestAxis() const;
+
+    AABB toAABB() const;
+};
+
+// Node of a flattened BVH. Nodes are stored depth first, so the first child of an interior
+// node is the node directly after it and only the second child needs an explicit offset.
+struct LinearBVHNode
+{
+    float boundsMin[3];
+    float boundsMax[3];
+    uint32_t offset;         // Leaf: first primitive slot, interior: index of the second child
+    uint16_t primitiveCount; // Zero for interior nodes
+    uint8_t axis;            // Split axis, used to visit the nearer child first
+    uint8_t pad;
+
+    bool isLeaf() const { return primitiveCount > 0; }
+    BVHBounds bounds() const;
+    void setBounds(const BVHBounds &bounds);
+};
+static_assert(sizeof(LinearBVHNode) == 32, "BVH nodes should stay 32 bytes, two per cache line");
+
+// Ray with the reciprocal direction precomputed for repeated slab tests.
+struct BVHRay
+{
+    explicit BVHRay(const Ray &r);
+
+    // Slab test against a node's bounds, restricted to [tMin, tMax].
+    bool hits(const LinearBVHNode &node, float tMin, float tMax) const
+    {
+        float t0 = tMin;
+        float t1 = tMax;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float tNear = (node.boundsMin[axis] - origin[axis]) * invDirection[axis];
+            float tFar = (node.boundsMax[axis] - origin[axis]) * invDirection[axis];
+            if (dirIsNeg[axis])
+                std::swap(tNear, tFar);
+            tFar *= farScale;
+            t0 = tNear > t0 ? tNear : t0;
+            t1 = tFar < t1 ? tFar : t1;
+        }
+        return t0 <= t1;
+    }
+
+    // Widens far distances by the rounding error of the slab computation (2 * gamma(3)), so rays through
+    // an edge or corner shared by two boxes cannot slip between them
+    static constexpr float farScale = 1.0f + 2.0f * 3.0f * 5.96046448e-8f;
+
+    glm::vec3 origin;
+    glm::vec3 invDirection;
+    int dirIsNeg[3];
+};
+
+// Strategy used to choose split planes while building a BVH.
+enum class BVHSplitMethod
+{
+    Median, // Split the longest axis at the median primitive
+    SAH,    // Binned surface area heuristic
+    LBVH,   // Morton code order, fastest to build, for interactive edits and animation
+};
+
+// Settings for BVH construction.
+struct BVHBuildOptions
+{
+    BVHSplitMethod splitMethod = BVHSplitMethod::SAH;
+    int maxLeafSize = 4;        // Most primitives a leaf may hold
+    int sahBinCount = 16;       // Buckets per axis evaluated by the SAH
+    float traversalCost = 1.0f; // Cost of visiting a node relative to one primitive test
+    int width = 2;              // Children per traversed node: 2, or 4/8 to collapse into a SIMD wide BVH
+    int mortonBits = 30;        // LBVH key length, 30 or 63 bits (finer grid for large scenes)
+
+    // Refit quality monitor: subtrees whose SAH cost grows past this multiple of their cost
+    // after the last build are rebuilt, the whole tree when the root itself degraded.
+    float refitRebuildThreshold = 1.5f;
+
+    ThreadPool *pool = nullptr;      // Builds large ranges in parallel when set, the result matches a serial build
+    size_t parallelThreshold = 4096; // Ranges smaller than this are built serially within one task
+};
+
+// Summary of a finished BVH build.
+struct BVHBuildStats
+{
+    double buildSeconds = 0.0;
+    size_t nodeCount = 0;
+    size_t leafCount = 0;
+    size_t primitiveCount = 0;
+    int depth = 0; // Levels from the root down to the deepest leaf
+};
+
+// Outcome of refitting a BVH after its primitives moved.
+struct BVHRefitStats
+{
+    float costRatio = 1.0f;     // SAH cost after refitting relative to the cost after the last build
+    size_t rebuiltSubtrees = 0; // Subtrees rebuilt because their cost degraded past the threshold
+    bool fullRebuild = false;
+    double seconds = 0.0;
+};
+
+// Bounding volume hierarchy over a set of primitive bounds, flattened into one contiguous array of nodes
+// and traversed with an explicit stack. Primitives stay owned by the caller: leaves cover a range of slots
+// and primitiveIndices maps each slot back to the index of the primitive it was built from.
+class LinearBVH
+{
+public:
+    std::vector<LinearBVHNode> nodes;
+    std::vector<uint32_t> primitiveIndices;
+    BVHBuildStats buildStats;
+
+    LinearBVH() = default;
+
+    // Builds the hierarchy over primitiveBounds using the given split strategy.
+    explicit LinearBVH(const std::vector<AABB> &primitiveBounds, const BVHBuildOptions &options = BVHBuildOptions());
+
+    // Visits the leaves reached by the ray, nearer child first, calling intersectLeaf(firstSlot, count, rayT).
+    // intersectLeaf returns whether it found a hit and, if so, shrinks rayT.max to the hit distance.
+    template <typename LeafFunction>
+    bool traverse(const Ray &r, Interval rayT, LeafFunction &&intersectLeaf) const;
+
+    // Bounds of the whole hierarchy.
+    AABB boundingBox() const;
+
+    // Updates node bounds bottom up for moved primitives (indexed like the build input) while keeping the
+    // topology, then rebuilds any part of the tree whose SAH cost degraded past options.refitRebuildThreshold.
+    BVHRefitStats refit(const std::vector<AABB> &primitiveBounds);
+
+    // SAH cost of the tree, relative to the area of its root.
+    float sahCost() const;
+
+    // Deepest a leaf may lie below the root, and so the most entries the traversal stack holds. Builders
+    // switch to median splits, which halve the primitive count, wherever a deeper tree could exceed it.
+    static constexpr int maxStackDepth = 64;
+
+    // Levels of median splits below a node over primitiveCount primitives until no leaf holds more than maxLeafSize.
+    static int medianSplitDepth(size_t primitiveCount, int maxLeafSize);
+
+private:
+    void build(const std::vector<AABB> &primitiveBounds);
+
+    // Unnormalised SAH cost of every subtree, children are always stored after their parent.
+    std::vector<float> subtreeCosts() const;
+
+    // Index one past the last node of every subtree.
+    std::vector<uint32_t> subtreeEnds() const;
+
+    // Levels between the root and every node.
+    std::vector<int> nodeDepths() const;
+
+    // Records the build statistics of the current nodes.
+    void updateBuildStats(double buildSeconds);
+
+    // Replaces the subtree at root with a fresh build over the same primitive slots, at most maxDepth levels deep.
+    // builtCost is spliced along with the nodes, the new subtree's entries are left for the caller to set.
+    // Returns the node count of the new subtree.
+    uint32_t rebuildSubtree(uint32_t root, uint32_t end, const std::vector<AABB> &primitiveBounds, int maxDepth);
+
+    BVHBuildOptions options;
+    std::vector<float> builtCost; // Per node subtree cost right after the last (re)build
+};
+
+// Traversal of a non-empty flattened node array, for nodes kept outside a LinearBVH such as in a mapped file.
+template <typename LeafFunction>
+bool traverseLinearBVH(const LinearBVHNode *nodes, const Ray &r, Interval rayT, LeafFunction &&intersectLeaf);
+
+template <typename LeafFunction>
+bool LinearBVH::traverse(const Ray &r, Interval rayT, LeafFunction &&intersectLeaf) const
+{
+    if (nodes.empty())
+        return false;
+    return traverseLinearBVH(nodes.data(), r, rayT, intersectLeaf);
+}
+
+template <typename LeafFunction>
+bool traverseLinearBVH(const LinearBVHNode *nodes, const Ray &r, Interval rayT, LeafFunction &&intersectLeaf)
+{
+    BVHRay ray(r);
+    uint32_t stack[LinearBVH::maxStackDepth];
+    int stackSize = 0;
+    uint32_t current = 0;
+    bool hitAnything = false;
+    uint64_t visited = 0; // Counted locally, the stats block is touched once per traversal
+
+    while (true)
+    {
+        const LinearBVHNode &node = nodes[current];
+        visited++;
+        if (ray.hits(node, static_cast<float>(rayT.min), static_cast<float>(rayT.max)))
+        {
+            if (node.isLeaf())
+            {
+                if (intersectLeaf(node.offset, node.primitiveCount, rayT))
+                    hitAnything = true;
+            }
+            else
+            {
+                // Descend into the child on the ray's side of the split first, the other one waits on the stack.
+                assert(stackSize < LinearBVH::maxStackDepth);
+                if (ray.dirIsNeg[node.axis])
+                {
+                    stack[stackSize++] = current + 1;
+                    current = node.offset;
+                }
+                else
+                {
+                    stack[stackSize++] = node.offset;
+                    current = current + 1;
+                }
+                continue;
+            }
+        }
+
+        if (stackSize == 0)
+            break;
+        current = stack[--stackSize];
+    }
+    LUMI_STAT(nodesVisited, visited);
+    LUMI_STAT(aabbTests, visited);
+    return hitAnything;
+}
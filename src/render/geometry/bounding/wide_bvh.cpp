@@ -0,0 +1,87 @@
+#include "wide_bvh.h"
+
+template <int Width>
+WideBVH<Width>::WideBVH(const LinearBVH &binary)
+{
+    if (binary.nodes.empty())
+        return;
+    nodes.reserve(binary.nodes.size() / (Width - 1) + 1);
+    collapse(binary, 0);
+}
+
+template <int Width>
+uint32_t WideBVH<Width>::collapse(const LinearBVH &binary, uint32_t binaryIndex)
+{
+    // Start from the binary node's children (or the node itself for a leaf root) and keep opening
+    // the largest interior child until the wide node is full.
+    uint32_t slots[Width];
+    int slotCount = 0;
+    const LinearBVHNode &root = binary.nodes[binaryIndex];
+    if (root.isLeaf())
+    {
+        slots[slotCount++] = binaryIndex;
+    }
+    else
+    {
+        slots[slotCount++] = binaryIndex + 1;
+        slots[slotCount++] = root.offset;
+    }
+
+    while (slotCount < Width)
+    {
+        int largest = -1;
+        float largestArea = -1.0f;
+        for (int i = 0; i < slotCount; i++)
+        {
+            const LinearBVHNode &candidate = binary.nodes[slots[i]];
+            float area = candidate.bounds().surfaceArea();
+            if (!candidate.isLeaf() && area > largestArea)
+            {
+                largest = i;
+                largestArea = area;
+            }
+        }
+        if (largest < 0)
+            break;
+
+        uint32_t opened = slots[largest];
+        slots[largest] = opened + 1;
+        slots[slotCount++] = binary.nodes[opened].offset;
+    }
+
+    auto wideIndex = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+    for (int lane = 0; lane < Width; lane++)
+    {
+        nodes[wideIndex].minX[lane] = nodes[wideIndex].minY[lane] = nodes[wideIndex].minZ[lane] = INFINITY;
+        nodes[wideIndex].maxX[lane] = nodes[wideIndex].maxY[lane] = nodes[wideIndex].maxZ[lane] = -INFINITY;
+        nodes[wideIndex].child[lane] = emptyChild;
+        nodes[wideIndex].count[lane] = 0;
+    }
+
+    for (int lane = 0; lane < slotCount; lane++)
+    {
+        const LinearBVHNode &child = binary.nodes[slots[lane]];
+        // Recursion grows the node array, so index rather than holding a reference
+        nodes[wideIndex].minX[lane] = child.boundsMin[0];
+        nodes[wideIndex].minY[lane] = child.boundsMin[1];
+        nodes[wideIndex].minZ[lane] = child.boundsMin[2];
+        nodes[wideIndex].maxX[lane] = child.boundsMax[0];
+        nodes[wideIndex].maxY[lane] = child.boundsMax[1];
+        nodes[wideIndex].maxZ[lane] = child.boundsMax[2];
+        if (child.isLeaf())
+        {
+            nodes[wideIndex].child[lane] = child.offset;
+            nodes[wideIndex].count[lane] = child.primitiveCount;
+        }
+        else
+        {
+            uint32_t childIndex = collapse(binary, slots[lane]);
+            nodes[wideIndex].child[lane] = childIndex;
+        }
+    }
+    return wideIndex;
+}
+
+template class WideBVH<4>;
+template class WideBVH<8>;
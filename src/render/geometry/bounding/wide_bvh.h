@@ -0,0 +1,198 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define LUMI_WIDE_BVH_SSE 1
+#endif
+
+#include "linear_bvh.h"
+
+// BVH with Width children per node, collapsed from a binary LinearBVH.
+// Child boxes are stored structure-of-arrays so all of them are slab tested at once with SSE/AVX,
+// and hit children are visited front to back by entry distance.
+// Leaves keep the primitive slots of the binary BVH they were built from.
+template <int Width>
+class WideBVH
+{
+    static_assert(Width == 4 || Width == 8, "Wide BVH nodes hold 4 or 8 children");
+
+public:
+    struct alignas(32) Node
+    {
+        float minX[Width], minY[Width], minZ[Width];
+        float maxX[Width], maxY[Width], maxZ[Width];
+        uint32_t child[Width]; // Interior child: node index, leaf child: first primitive slot
+        uint32_t count[Width]; // Primitives of a leaf child, zero for interior and empty children
+    };
+
+    static constexpr uint32_t emptyChild = 0xFFFFFFFF;
+
+    std::vector<Node> nodes;
+
+    WideBVH() = default;
+    explicit WideBVH(const LinearBVH &binary);
+
+    // Same contract as LinearBVH::traverse, leaves are reported nearest first.
+    template <typename LeafFunction>
+    bool traverse(const Ray &r, Interval rayT, LeafFunction &&intersectLeaf) const;
+
+    // Slab tests every child of a node, writing entry distances and returning a bit mask of the children hit.
+    int intersectChildren(const Node &node, const BVHRay &ray, float tMin, float tMax, float tEntry[Width]) const;
+
+private:
+    // Emits a wide node for the binary subtree rooted at binaryIndex and returns its index.
+    uint32_t collapse(const LinearBVH &binary, uint32_t binaryIndex);
+};
+
+using BVH4 = WideBVH<4>;
+using BVH8 = WideBVH<8>;
+
+template <int Width>
+int WideBVH<Width>::intersectChildren(const Node &node, const BVHRay &ray, float tMin, float tMax, float tEntry[Width]) const
+{
+    // Choosing near/far planes per axis from the ray's direction signs avoids per-lane min/max
+    const float *nearX = ray.dirIsNeg[0] ? node.maxX : node.minX;
+    const float *farX = ray.dirIsNeg[0] ? node.minX : node.maxX;
+    const float *nearY = ray.dirIsNeg[1] ? node.maxY : node.minY;
+    const float *farY = ray.dirIsNeg[1] ? node.minY : node.maxY;
+    const float *nearZ = ray.dirIsNeg[2] ? node.maxZ : node.minZ;
+    const float *farZ = ray.dirIsNeg[2] ? node.minZ : node.maxZ;
+
+    int mask = 0;
+#if defined(__AVX__)
+    if constexpr (Width == 8)
+    {
+        const __m256 ox = _mm256_set1_ps(ray.origin.x), oy = _mm256_set1_ps(ray.origin.y), oz = _mm256_set1_ps(ray.origin.z);
+        const __m256 ix = _mm256_set1_ps(ray.invDirection.x), iy = _mm256_set1_ps(ray.invDirection.y), iz = _mm256_set1_ps(ray.invDirection.z);
+        const __m256 farScale = _mm256_set1_ps(BVHRay::farScale);
+
+        // Candidate first: max/min return the second operand when a lane is NaN (0 * inf on a slab plane)
+        __m256 t0 = _mm256_set1_ps(tMin);
+        __m256 t1 = _mm256_set1_ps(tMax);
+        t0 = _mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(nearX), ox), ix), t0);
+        t0 = _mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(nearY), oy), iy), t0);
+        t0 = _mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(nearZ), oz), iz), t0);
+        t1 = _mm256_min_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(farX), ox), ix), farScale), t1);
+        t1 = _mm256_min_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(farY), oy), iy), farScale), t1);
+        t1 = _mm256_min_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(farZ), oz), iz), farScale), t1);
+
+        _mm256_storeu_ps(tEntry, t0);
+        return _mm256_movemask_ps(_mm256_cmp_ps(t0, t1, _CMP_LE_OQ));
+    }
+#endif
+#if defined(LUMI_WIDE_BVH_SSE)
+    const __m128 ox = _mm_set1_ps(ray.origin.x), oy = _mm_set1_ps(ray.origin.y), oz = _mm_set1_ps(ray.origin.z);
+    const __m128 ix = _mm_set1_ps(ray.invDirection.x), iy = _mm_set1_ps(ray.invDirection.y), iz = _mm_set1_ps(ray.invDirection.z);
+    const __m128 farScale = _mm_set1_ps(BVHRay::farScale);
+    for (int lane = 0; lane < Width; lane += 4)
+    {
+        __m128 t0 = _mm_set1_ps(tMin);
+        __m128 t1 = _mm_set1_ps(tMax);
+        t0 = _mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(nearX + lane), ox), ix), t0);
+        t0 = _mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(nearY + lane), oy), iy), t0);
+        t0 = _mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(nearZ + lane), oz), iz), t0);
+        t1 = _mm_min_ps(_mm_mul_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(farX + lane), ox), ix), farScale), t1);
+        t1 = _mm_min_ps(_mm_mul_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(farY + lane), oy), iy), farScale), t1);
+        t1 = _mm_min_ps(_mm_mul_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(farZ + lane), oz), iz), farScale), t1);
+
+        _mm_storeu_ps(tEntry + lane, t0);
+        mask |= _mm_movemask_ps(_mm_cmple_ps(t0, t1)) << lane;
+    }
+#else
+    for (int lane = 0; lane < Width; lane++)
+    {
+        float t0 = tMin;
+        float t1 = tMax;
+        float tx0 = (nearX[lane] - ray.origin.x) * ray.invDirection.x;
+        float ty0 = (nearY[lane] - ray.origin.y) * ray.invDirection.y;
+        float tz0 = (nearZ[lane] - ray.origin.z) * ray.invDirection.z;
+        float tx1 = (farX[lane] - ray.origin.x) * ray.invDirection.x * BVHRay::farScale;
+        float ty1 = (farY[lane] - ray.origin.y) * ray.invDirection.y * BVHRay::farScale;
+        float tz1 = (farZ[lane] - ray.origin.z) * ray.invDirection.z * BVHRay::farScale;
+        t0 = tx0 > t0 ? tx0 : t0;
+        t0 = ty0 > t0 ? ty0 : t0;
+        t0 = tz0 > t0 ? tz0 : t0;
+        t1 = tx1 < t1 ? tx1 : t1;
+        t1 = ty1 < t1 ? ty1 : t1;
+        t1 = tz1 < t1 ? tz1 : t1;
+        tEntry[lane] = t0;
+        if (t0 <= t1)
+            mask |= 1 << lane;
+    }
+#endif
+    return mask;
+}
+
+template <int Width>
+template <typename LeafFunction>
+bool WideBVH<Width>::traverse(const Ray &r, Interval rayT, LeafFunction &&intersectLeaf) const
+{
+    if (nodes.empty())
+        return false;
+
+    struct StackEntry
+    {
+        uint32_t child;
+        uint32_t count;
+        float tEntry;
+    };
+
+    BVHRay ray(r);
+    StackEntry stack[LinearBVH::maxStackDepth * (Width - 1) + 1];
+    int stackSize = 0;
+    stack[stackSize++] = {0, 0, static_cast<float>(rayT.min)};
+    bool hitAnything = false;
+    uint64_t visited = 0;
+    uint64_t boxTests = 0;
+
+    alignas(32) float tEntry[Width];
+    while (stackSize > 0)
+    {
+        StackEntry entry = stack[--stackSize];
+        // A closer hit may have been found since this entry was pushed
+        if (entry.tEntry > rayT.max)
+            continue;
+
+        visited++;
+        if (entry.count > 0)
+        {
+            if (intersectLeaf(entry.child, entry.count, rayT))
+                hitAnything = true;
+            continue;
+        }
+
+        const Node &node = nodes[entry.child];
+        boxTests += Width;
+        int mask = intersectChildren(node, ray, static_cast<float>(rayT.min), static_cast<float>(rayT.max), tEntry);
+
+        // Order hit children far to near, pushing them in that order leaves the nearest on top of the stack
+        int order[Width];
+        int hitCount = 0;
+        for (int lane = 0; lane < Width; lane++)
+        {
+            if (!(mask & (1 << lane)))
+                continue;
+            int position = hitCount++;
+            while (position > 0 && tEntry[order[position - 1]] < tEntry[lane])
+            {
+                order[position] = order[position - 1];
+                position--;
+            }
+            order[position] = lane;
+        }
+        // Binary trees are at most maxStackDepth deep, so every level leaves at most Width - 1 entries behind
+        assert(stackSize + hitCount <= LinearBVH::maxStackDepth * (Width - 1) + 1);
+        for (int i = 0; i < hitCount; i++)
+        {
+            int lane = order[i];
+            stack[stackSize++] = {node.child[lane], node.count[lane], tEntry[lane]};
+        }
+    }
+    LUMI_STAT(nodesVisited, visited);
+    LUMI_STAT(aabbTests, boxTests);
+    return hitAnything;
+}
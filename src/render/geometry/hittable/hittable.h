@@ -1,27 +1,29 @@
 #pragma once
 
 #include <glm/vec3.hpp>
+#include <cstdint>
 #include <memory>
+#include <type_traits>
 #include "../ray.h"
 #include "../interval.h"
 #include "../bounding/aabb.h"
-
-// Forward declaration of Material class.
-class Material;
+#include "../affine.h"
+#include "utils.h"
 
 // Record of a ray-object intersection.
 class HitRecord
 {
 public:
-    glm::vec3 point;               // Intersection point
-    glm::vec3 normal;              // Normal at the intersection
-    std::shared_ptr<Material> mat; // Material of the intersected object
-    float t;                       // Ray parameter at intersection
-    bool frontFace;                // Whether the intersection is a front face
+    glm::vec3 point;   // Intersection point
+    glm::vec3 normal;  // Normal at the intersection
+    uint32_t material; // Index of the intersected object's material in the scene's MaterialTable
+    float t;           // Ray parameter at intersection
+    bool frontFace;    // Whether the intersection is a front face
 
     // Sets the normal depending on the ray direction to ensure it always points against the ray.
     void setFaceNormal(const Ray &r, const glm::vec3 &outwardNormal);
 };
+static_assert(std::is_trivially_copyable_v<HitRecord>, "Hit records are copied per candidate hit and must stay plain data");
 
 // Abstract class representing a hittable object in the scene.
 class Hittable
@@ -40,7 +42,8 @@ public:
         return 0.0;
     }
 
-    virtual glm::vec3 random(const glm::vec3 &origin) const
+    // Samples a direction from origin towards the object.
+    virtual glm::vec3 random(const glm::vec3 &origin, Utils::Random::RNG &rng) const
     {
         return glm::vec3(1, 0, 0);
     }
@@ -68,6 +71,10 @@ public:
 
     AABB boundingBox() const override { return bbox; }
 
+    // The wrapped object and the equivalent affine transform, used to collapse wrapper chains.
+    const std::shared_ptr<Hittable> &wrapped() const { return object; }
+    AffineTransform transform() const { return AffineTransform::translation(offset); }
+
 private:
     std::shared_ptr<Hittable> object;
     glm::vec3 offset;
@@ -136,6 +143,18 @@ public:
 
     AABB boundingBox() const override { return bbox; }
 
+    // The wrapped object and the equivalent affine transform, used to collapse wrapper chains.
+    const std::shared_ptr<Hittable> &wrapped() const { return object; }
+    AffineTransform transform() const
+    {
+        AffineTransform rotation;
+        rotation.m[0][0] = static_cast<float>(cosTheta);
+        rotation.m[0][2] = static_cast<float>(sinTheta);
+        rotation.m[2][0] = static_cast<float>(-sinTheta);
+        rotation.m[2][2] = static_cast<float>(cosTheta);
+        return rotation;
+    }
+
 private:
     std::shared_ptr<Hittable> object;
     double sinTheta;
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <memory>
+#include "transform.h"
+#include "geometry/bounding/bvh.h"
+
+// Places a bottom-level BVH in the scene under an affine transform. Any number of instances can share one
+// BLAS, so copies of an object cost one hierarchy in memory. Build a BVHNode over the instances as the
+// top level: after moving instances with setTransform, refit it and no BLAS needs rebuilding.
+class Instance : public Transform
+{
+public:
+    Instance(std::shared_ptr<const BVHNode> blas, const AffineTransform &objectToWorld)
+        : Transform(std::move(blas), objectToWorld)
+    {
+    }
+};
@@ -0,0 +1,87 @@
+#include "transform.h"
+
+Transform::Transform(std::shared_ptr<const Hittable> object, const AffineTransform &objectToWorld)
+    : object(std::move(object))
+{
+    setTransform(objectToWorld);
+}
+
+void Transform::setTransform(const AffineTransform &newObjectToWorld)
+{
+    objectToWorld = newObjectToWorld;
+    worldToObject = newObjectToWorld.inverse();
+    worldToObjectDeterminant = std::fabs(worldToObject.determinant());
+    bbox = objectToWorld.bounds(object->boundingBox());
+}
+
+bool Transform::hit(const Ray &r, Interval rayT, HitRecord &rec) const
+{
+    // The direction is not renormalised, so t means the same in both spaces
+    Ray objectRay(worldToObject.point(r.origin()), worldToObject.vector(r.direction()));
+    if (!object->hit(objectRay, rayT, rec))
+        return false;
+
+    rec.point = objectToWorld.point(rec.point);
+    rec.normal = glm::normalize(worldToObject.transposedVector(rec.normal));
+    return true;
+}
+
+AABB Transform::boundingBox() const { return bbox; }
+
+double Transform::pdfValue(const glm::vec3 &origin, const glm::vec3 &direction) const
+{
+    // For a unit world direction w and the linear part A of worldToObject, the object space direction
+    // A w / |A w| covers |det A| / |A w|^3 times the solid angle of w
+    glm::vec3 unit = glm::normalize(direction);
+    glm::vec3 objectDirection = worldToObject.vector(unit);
+    double objectPdf = object->pdfValue(worldToObject.point(origin), objectDirection);
+    double length = glm::length(objectDirection);
+    return objectPdf * worldToObjectDeterminant / (length * length * length);
+}
+
+glm::vec3 Transform::random(const glm::vec3 &origin, Utils::Random::RNG &rng) const
+{
+    return objectToWorld.vector(object->random(worldToObject.point(origin), rng));
+}
+
+int unwrapTransforms(std::shared_ptr<const Hittable> &object, AffineTransform &objectToWorld)
+{
+    int wrappers = 0;
+    while (true)
+    {
+        if (auto translate = std::dynamic_pointer_cast<const Translate>(object))
+        {
+            objectToWorld = objectToWorld * translate->transform();
+            object = translate->wrapped();
+        }
+        else if (auto rotate = std::dynamic_pointer_cast<const RotateY>(object))
+        {
+            objectToWorld = objectToWorld * rotate->transform();
+            object = rotate->wrapped();
+        }
+        else if (auto transform = std::dynamic_pointer_cast<const Transform>(object))
+        {
+            objectToWorld = objectToWorld * transform->transform();
+            object = transform->wrapped();
+        }
+        else
+            break;
+        wrappers++;
+    }
+    return wrappers;
+}
+
+std::shared_ptr<Hittable> collapseTransforms(const std::shared_ptr<Hittable> &object)
+{
+    AffineTransform objectToWorld;
+    std::shared_ptr<const Hittable> inner = object;
+    if (unwrapTransforms(inner, objectToWorld) == 0)
+        return object;
+    return std::make_shared<Transform>(inner, objectToWorld);
+}
+
+void collapseTransforms(HittableList &list)
+{
+    for (auto &object : list.objects)
+        object = collapseTransforms(object);
+}
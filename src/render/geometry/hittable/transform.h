@@ -0,0 +1,46 @@
+#pragma once
+
+#include <memory>
+#include "hittable.h"
+#include "hittable_list.h"
+#include "geometry/affine.h"
+
+// Applies an affine transform to a hittable object. The matrix and its inverse are precomputed in float,
+// so a hit moves the ray into object space and the hit point and normal back in one pass each.
+class Transform : public Hittable
+{
+public:
+    Transform(std::shared_ptr<const Hittable> object, const AffineTransform &objectToWorld);
+
+    bool hit(const Ray &r, Interval rayT, HitRecord &rec) const override;
+    AABB boundingBox() const override;
+
+    // Light sampling goes through the wrapped object in object space. Directions map linearly between the
+    // spaces, and the solid angle pdf picks up the Jacobian of that map.
+    double pdfValue(const glm::vec3 &origin, const glm::vec3 &direction) const override;
+    glm::vec3 random(const glm::vec3 &origin, Utils::Random::RNG &rng) const override;
+
+    // Moves the object, a BVH containing it must be refit afterwards.
+    void setTransform(const AffineTransform &newObjectToWorld);
+    const AffineTransform &transform() const { return objectToWorld; }
+
+    const std::shared_ptr<const Hittable> &wrapped() const { return object; }
+
+private:
+    std::shared_ptr<const Hittable> object;
+    AffineTransform objectToWorld;
+    AffineTransform worldToObject;
+    float worldToObjectDeterminant;
+    AABB bbox;
+};
+
+// Follows a chain of Translate, RotateY and Transform wrappers down to the wrapped object, replacing object
+// with it and composing the wrappers into objectToWorld. Returns the number of wrappers passed.
+int unwrapTransforms(std::shared_ptr<const Hittable> &object, AffineTransform &objectToWorld);
+
+// Replaces a chain of Translate, RotateY and Transform wrappers around an object with one Transform.
+// Objects that are not wrapped are returned unchanged.
+std::shared_ptr<Hittable> collapseTransforms(const std::shared_ptr<Hittable> &object);
+
+// Collapses the transform chains of every object in the list.
+void collapseTransforms(HittableList &list);
@@ -0,0 +1,136 @@
+#include "primitive_arrays.h"
+#include "triangle_mesh.h"
+#include "geometry/bounding/bvh.h"
+#include "geometry/hittable/transform.h"
+#include <cassert>
+#include <iostream>
+
+namespace
+{
+    PrimitiveRef makeRef(PrimitiveType type, size_t index)
+    {
+        return PrimitiveRef{type, static_cast<uint32_t>(index)};
+    }
+}
+
+PrimitiveRef PrimitiveArrays::add(const std::shared_ptr<const Hittable> &object)
+{
+    if (auto sphere = std::dynamic_pointer_cast<const Sphere>(object))
+    {
+        spheres.centers.push_back(sphere->center);
+        spheres.radii.push_back(sphere->radius);
+        spheres.materials.push_back(sphere->material);
+        return makeRef(PrimitiveType::Sphere, spheres.radii.size() - 1);
+    }
+    if (auto quad = std::dynamic_pointer_cast<const Quad>(object))
+    {
+        quads.corners.push_back(quad->Q);
+        quads.u.push_back(quad->u);
+        quads.v.push_back(quad->v);
+        quads.normals.push_back(quad->normal);
+        quads.planeOffsets.push_back(quad->D);
+        quads.w.push_back(quad->basis_scaling_factor);
+        quads.materials.push_back(quad->material);
+        return makeRef(PrimitiveType::Quad, quads.corners.size() - 1);
+    }
+    if (auto list = std::dynamic_pointer_cast<const HittableList>(object))
+        return add(*list);
+
+    AffineTransform objectToWorld;
+    std::shared_ptr<const Hittable> inner = object;
+    if (unwrapTransforms(inner, objectToWorld) > 0)
+    {
+        // The wrapped object is compiled first, it may add transforms of its own
+        PrimitiveRef wrapped = add(inner);
+        transforms.push_back(TransformEntry{objectToWorld, objectToWorld.inverse(), wrapped});
+        return makeRef(PrimitiveType::Transform, transforms.size() - 1);
+    }
+
+    auto found = referenced.find(object.get());
+    if (found != referenced.end())
+        return found->second;
+
+    PrimitiveRef ref;
+    if (auto mesh = std::dynamic_pointer_cast<const TriangleMesh>(object))
+    {
+        meshes.push_back(mesh.get());
+        ref = makeRef(PrimitiveType::Mesh, meshes.size() - 1);
+    }
+    else if (auto bvh = std::dynamic_pointer_cast<const BVHNode>(object))
+    {
+        bvhs.push_back(bvh.get());
+        ref = makeRef(PrimitiveType::BVH, bvhs.size() - 1);
+    }
+    else
+    {
+        // Rendering never calls a virtual hit(), every hittable type needs a case above
+        std::cerr << "PrimitiveArrays: cannot compile a hittable of unknown type, it is left out of the scene" << std::endl;
+        assert(false && "PrimitiveArrays::add has no case for this hittable type");
+        return add(HittableList());
+    }
+    owners.push_back(object);
+    referenced.emplace(object.get(), ref);
+    return ref;
+}
+
+PrimitiveRef PrimitiveArrays::add(const HittableList &list)
+{
+    // Members are compiled before the group claims its range, nested groups append members of their own
+    std::vector<PrimitiveRef> members;
+    members.reserve(list.objects.size());
+    for (const auto &object : list.objects)
+        members.push_back(add(object));
+
+    groups.push_back(GroupEntry{static_cast<uint32_t>(groupMembers.size()), static_cast<uint32_t>(members.size())});
+    groupMembers.insert(groupMembers.end(), members.begin(), members.end());
+    return makeRef(PrimitiveType::Group, groups.size() - 1);
+}
+
+bool PrimitiveArrays::hitCompound(PrimitiveRef primitive, const Ray &r, Interval rayT, HitRecord &rec) const
+{
+    uint32_t i = primitive.index;
+    switch (primitive.type)
+    {
+    case PrimitiveType::Mesh:
+        return meshes[i]->hit(r, rayT, rec); // Final class, called directly
+    case PrimitiveType::BVH:
+        return bvhs[i]->hit(r, rayT, rec); // Final class, called directly
+    case PrimitiveType::Transform:
+        return hitTransform(transforms[i], r, rayT, rec);
+    case PrimitiveType::Group:
+        return hitGroup(groups[i], r, rayT, rec);
+    default:
+        return hit(primitive, r, rayT, rec);
+    }
+}
+
+bool PrimitiveArrays::hitTransform(const TransformEntry &transform, const Ray &r, Interval rayT, HitRecord &rec) const
+{
+    // As Transform::hit: the direction is not renormalised, so t means the same in both spaces
+    Ray objectRay(transform.worldToObject.point(r.origin()), transform.worldToObject.vector(r.direction()));
+    if (!hit(transform.object, objectRay, rayT, rec))
+        return false;
+
+    rec.point = transform.objectToWorld.point(rec.point);
+    rec.normal = glm::normalize(transform.worldToObject.transposedVector(rec.normal));
+    return true;
+}
+
+bool PrimitiveArrays::hitGroup(const GroupEntry &group, const Ray &r, Interval rayT, HitRecord &rec) const
+{
+    bool hitAnything = false;
+    for (uint32_t member = group.first; member < group.first + group.count; member++)
+    {
+        if (hit(groupMembers[member], r, rayT, rec))
+        {
+            hitAnything = true;
+            rayT.max = rec.t;
+        }
+    }
+    return hitAnything;
+}
+
+void PrimitiveArrays::clear()
+{
+    *this = PrimitiveArrays();
+}
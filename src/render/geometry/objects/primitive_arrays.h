@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include "geometry/hittable/hittable.h"
+#include "geometry/hittable/hittable_list.h"
+#include "geometry/affine.h"
+#include "sphere.h"
+#include "quad.h"
+
+class BVHNode;
+class TriangleMesh;
+
+// Kinds of primitive kept in a PrimitiveArrays, each in arrays of its own.
+enum class PrimitiveType : uint32_t
+{
+    Sphere,
+    Quad,
+    Mesh,      // Triangle mesh, which has its own BVH
+    BVH,       // Nested hierarchy, e.g. the BLAS shared by instances
+    Transform, // Another primitive under an affine transform
+    Group,     // Primitives tested one after another, e.g. a box's six quads
+};
+
+// Type of a primitive and its index within that type's arrays.
+struct PrimitiveRef
+{
+    PrimitiveType type;
+    uint32_t index;
+};
+
+// Scene geometry compiled from the authoring Hittable objects into per-type structure of arrays, e.g. sphere
+// centers, radii and materials each in one array. Primitives are referenced by (type, index) and intersected
+// with a switch over the type, so rendering makes no virtual hit() calls. The arrays hold a snapshot of the
+// geometry: compile the objects again after moving them.
+class PrimitiveArrays
+{
+public:
+    // Compiles object and everything it contains, returning the reference to intersect it with. Lists become
+    // groups and wrapper chains one transform. Meshes and BVHs are referenced rather than copied, so instances
+    // sharing a BLAS still share it here. A hittable type with no case here is an error: it asserts and is
+    // left out as an empty group.
+    PrimitiveRef add(const std::shared_ptr<const Hittable> &object);
+
+    // Compiles the objects of list as one group.
+    PrimitiveRef add(const HittableList &list);
+
+    // Intersects one primitive, filling rec when it is hit inside rayT. Spheres and quads are tested inline.
+    bool hit(PrimitiveRef primitive, const Ray &r, Interval rayT, HitRecord &rec) const
+    {
+        uint32_t i = primitive.index;
+        switch (primitive.type)
+        {
+        case PrimitiveType::Sphere:
+            return intersectSphere(spheres.centers[i], spheres.radii[i], spheres.materials[i], r, rayT, rec);
+        case PrimitiveType::Quad:
+            return intersectQuad(quads.corners[i], quads.u[i], quads.v[i], quads.normals[i], quads.planeOffsets[i], quads.w[i],
+                                 quads.materials[i], r, rayT, rec);
+        default:
+            return hitCompound(primitive, r, rayT, rec);
+        }
+    }
+
+    void clear();
+
+private:
+    struct SphereArrays
+    {
+        std::vector<glm::vec3> centers;
+        std::vector<float> radii;
+        std::vector<uint32_t> materials;
+    };
+
+    struct QuadArrays
+    {
+        std::vector<glm::vec3> corners;
+        std::vector<glm::vec3> u;
+        std::vector<glm::vec3> v;
+        std::vector<glm::vec3> normals;
+        std::vector<double> planeOffsets;
+        std::vector<glm::vec3> w; // Plane normal over the squared length of cross(u, v), gives the hit's u/v coordinates
+        std::vector<uint32_t> materials;
+    };
+
+    struct TransformEntry
+    {
+        AffineTransform objectToWorld;
+        AffineTransform worldToObject;
+        PrimitiveRef object;
+    };
+
+    struct GroupEntry
+    {
+        uint32_t first; // Into groupMembers
+        uint32_t count;
+    };
+
+    // Primitives other than spheres and quads.
+    bool hitCompound(PrimitiveRef primitive, const Ray &r, Interval rayT, HitRecord &rec) const;
+    bool hitTransform(const TransformEntry &transform, const Ray &r, Interval rayT, HitRecord &rec) const;
+    bool hitGroup(const GroupEntry &group, const Ray &r, Interval rayT, HitRecord &rec) const;
+
+    SphereArrays spheres;
+    QuadArrays quads;
+    std::vector<const TriangleMesh *> meshes;
+    std::vector<const BVHNode *> bvhs;
+    std::vector<TransformEntry> transforms;
+    std::vector<GroupEntry> groups;
+    std::vector<PrimitiveRef> groupMembers;
+
+    std::vector<std::shared_ptr<const Hittable>> owners;            // Keeps referenced meshes and BVHs alive
+    std::unordered_map<const Hittable *, PrimitiveRef> referenced; // Objects already referenced, added once however often shared
+};
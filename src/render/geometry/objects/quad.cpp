@@ -2,8 +2,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtx/intersect.hpp>
 
-Quad::Quad(const glm::vec3 &Q, const glm::vec3 &u, const glm::vec3 &v, std::shared_ptr<Material> mat)
-    : Q(Q), u(u), v(v), mat(mat)
+Quad::Quad(const glm::vec3 &Q, const glm::vec3 &u, const glm::vec3 &v, uint32_t material)
+    : Q(Q), u(u), v(v), material(material)
 {
     glm::vec3 n = cross(u, v); // Normal to the plane containing the quad
     normal = glm::normalize(n);
@@ -26,26 +26,7 @@ AABB Quad::boundingBox() const { return bbox; }
 
 bool Quad::hit(const Ray &r, Interval ray_t, HitRecord &rec) const
 {
-    auto denominator = glm::dot(normal, r.direction());
-    if (fabs(denominator) < 1e-8)
-        return false;
-    auto t = (D - dot(normal, r.origin())) / denominator;
-    if (!ray_t.contains(t))
-        return false;
-
-    auto intersection = r.at(t);
-    glm::vec3 planar_hitpt_vector = intersection - Q;
-    auto alpha = glm::dot(basis_scaling_factor, glm::cross(planar_hitpt_vector, v));
-    auto beta = glm::dot(basis_scaling_factor, glm::cross(u, planar_hitpt_vector));
-    if (!inQuad(alpha, beta))
-        return false;
-
-    rec.t = t;
-    rec.point = intersection;
-    rec.mat = mat;
-    rec.setFaceNormal(r, normal);
-
-    return true;
+    return intersectQuad(Q, u, v, normal, D, basis_scaling_factor, material, r, ray_t, rec);
 }
 
 bool Quad::inQuad(double alpha, double beta) const
@@ -66,13 +47,13 @@ double Quad::pdfValue(const glm::vec3 &origin, const glm::vec3 &direction) const
     return distance_squared / (cosine * area);
 }
 
-glm::vec3 Quad::random(const glm::vec3 &origin) const
+glm::vec3 Quad::random(const glm::vec3 &origin, Utils::Random::RNG &rng) const
 {
-    auto p = Q + (float(Utils::Random::randomDouble()) * u) + (float(Utils::Random::randomDouble()) * v);
+    auto p = Q + (rng.nextFloat() * u) + (rng.nextFloat() * v);
     return p - origin;
 }
 
-std::shared_ptr<HittableList> Box(const glm::vec3 &a, const glm::vec3 &b, std::shared_ptr<Material> mat)
+std::shared_ptr<HittableList> Box(const glm::vec3 &a, const glm::vec3 &b, uint32_t material)
 {
     auto sides = std::make_shared<HittableList>();
     auto min = glm::min(a, b);
@@ -82,12 +63,12 @@ std::shared_ptr<HittableList> Box(const glm::vec3 &a, const glm::vec3 &b, std::s
     glm::vec3 dy(0, max.y - min.y, 0);
     glm::vec3 dz(0, 0, max.z - min.z);
 
-    sides->add(std::make_shared<Quad>(glm::vec3(min.x, min.y, max.z), dx, dy, mat));  // front
-    sides->add(std::make_shared<Quad>(glm::vec3(max.x, min.y, max.z), -dz, dy, mat)); // right
-    sides->add(std::make_shared<Quad>(glm::vec3(max.x, min.y, min.z), -dx, dy, mat)); // back
-    sides->add(std::make_shared<Quad>(glm::vec3(min.x, min.y, min.z), dz, dy, mat));  // left
-    sides->add(std::make_shared<Quad>(glm::vec3(min.x, max.y, max.z), dx, -dz, mat)); // top
-    sides->add(std::make_shared<Quad>(glm::vec3(min.x, min.y, min.z), dx, dz, mat));  // bottom
+    sides->add(std::make_shared<Quad>(glm::vec3(min.x, min.y, max.z), dx, dy, material));  // front
+    sides->add(std::make_shared<Quad>(glm::vec3(max.x, min.y, max.z), -dz, dy, material)); // right
+    sides->add(std::make_shared<Quad>(glm::vec3(max.x, min.y, min.z), -dx, dy, material)); // back
+    sides->add(std::make_shared<Quad>(glm::vec3(min.x, min.y, min.z), dz, dy, material));  // left
+    sides->add(std::make_shared<Quad>(glm::vec3(min.x, max.y, max.z), dx, -dz, material)); // top
+    sides->add(std::make_shared<Quad>(glm::vec3(min.x, min.y, min.z), dx, dz, material));  // bottom
 
     return sides;
 }
\ No newline at end of file
@@ -2,25 +2,56 @@
 
 #include "../hittable/hittable.h"
 #include "../hittable/hittable_list.h"
-#include "material/material.h"
 #include "../bounding/aabb.h"
 #include "../interval.h"
 #include "../ray.h"
+#include "stats/ray_stats.h"
+
+// Ray/quad test shared by Quad and the per-type primitive arrays. normal and D describe the quad's plane and
+// w is its normal divided by the squared length of cross(u, v). Fills rec when the ray hits inside ray_t.
+inline bool intersectQuad(const glm::vec3 &Q, const glm::vec3 &u, const glm::vec3 &v, const glm::vec3 &normal, double D,
+                          const glm::vec3 &w, uint32_t material, const Ray &r, Interval ray_t, HitRecord &rec)
+{
+    LUMI_STAT(primitiveTests, 1);
+    auto denominator = glm::dot(normal, r.direction());
+    if (fabs(denominator) < 1e-8)
+        return false;
+    auto t = (D - dot(normal, r.origin())) / denominator;
+    if (!ray_t.contains(t))
+        return false;
+
+    auto intersection = r.at(t);
+    glm::vec3 planar_hitpt_vector = intersection - Q;
+    double alpha = glm::dot(w, glm::cross(planar_hitpt_vector, v));
+    double beta = glm::dot(w, glm::cross(u, planar_hitpt_vector));
+    auto unit_interval = Interval(0, 1);
+    if (!unit_interval.contains(alpha) || !unit_interval.contains(beta))
+        return false;
+
+    rec.t = t;
+    rec.point = intersection;
+    rec.material = material;
+    rec.setFaceNormal(r, normal);
+
+    return true;
+}
 
 // Quad class represents a rectangular plane in 3D space.
-class Quad : public Hittable
+class Quad final : public Hittable
 {
 public:
-    Quad(const glm::vec3 &Q, const glm::vec3 &u, const glm::vec3 &v, std::shared_ptr<Material> mat);
+    Quad(const glm::vec3 &Q, const glm::vec3 &u, const glm::vec3 &v, uint32_t material);
 
     void setBoundingBox();
     AABB boundingBox() const override;
     bool hit(const Ray &r, Interval ray_t, HitRecord &rec) const override;
     bool inQuad(double alpha, double beta) const;
     double pdfValue(const glm::vec3 &origin, const glm::vec3 &direction) const override;
-    glm::vec3 random(const glm::vec3 &origin) const override;
+    glm::vec3 random(const glm::vec3 &origin, Utils::Random::RNG &rng) const override;
 
 private:
+    friend class PrimitiveArrays; // Copies the geometry into its per-type arrays
+
     glm::vec3 Q; // A corner
     glm::vec3 u; // Vectors to the other corners
     glm::vec3 v;
@@ -31,8 +62,8 @@ private:
     double D; // Offset of the plane from origin
 
     AABB bbox;
-    std::shared_ptr<Material> mat;
+    uint32_t material; // Index into the scene's MaterialTable
 };
 
 // Generates a box formed by quads between two points in space.
-std::shared_ptr<HittableList> Box(const glm::vec3 &a, const glm::vec3 &b, std::shared_ptr<Material> mat);
\ No newline at end of file
+std::shared_ptr<HittableList> Box(const glm::vec3 &a, const glm::vec3 &b, uint32_t material);
\ No newline at end of file
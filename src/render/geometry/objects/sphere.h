@@ -5,19 +5,55 @@
 #include "geometry/ray.h"
 #include "../interval.h"
 #include "geometry/bounding/aabb.h"
-#include "material/material.h"
+#include "stats/ray_stats.h"
 
-class Sphere : public Hittable
+// Ray/sphere test shared by Sphere and the per-type primitive arrays. Fills rec when the ray hits inside ray_t.
+inline bool intersectSphere(const glm::vec3 &center, float radius, uint32_t material, const Ray &r, Interval ray_t, HitRecord &rec)
+{
+    LUMI_STAT(primitiveTests, 1);
+    glm::vec3 origin_to_center = center - r.origin();
+    float a = glm::length2(r.direction());
+    float h = dot(r.direction(), origin_to_center);
+    float c = glm::length2(origin_to_center) - radius * radius;
+    float discriminant = h * h - a * c;
+    if (discriminant < 0)
+        return false;
+
+    auto sqrtd = sqrt(discriminant);
+    auto root = (h - sqrtd) / a;
+    if (!ray_t.surrounds(root))
+    {
+        root = (h + sqrtd) / a;
+        if (!ray_t.surrounds(root))
+            return false;
+    }
+
+    rec.t = root;
+    rec.point = r.at(rec.t);
+    glm::vec3 outward_normal = (rec.point - center) / radius;
+    rec.setFaceNormal(r, outward_normal);
+    rec.normal = (rec.point - center) / radius;
+    rec.material = material;
+
+    return true;
+}
+
+class Sphere final : public Hittable
 {
 public:
-    Sphere(const glm::vec3 &center, float radius, std::shared_ptr<Material> material);
+    Sphere(const glm::vec3 &center, float radius, uint32_t material);
 
     bool hit(const Ray &r, Interval ray_t, HitRecord &rec) const override;
     AABB boundingBox() const override;
 
+    // Moves the sphere, a BVH containing it must be refit afterwards.
+    void setCenter(const glm::vec3 &newCenter);
+
 private:
+    friend class PrimitiveArrays; // Copies the geometry into its per-type arrays
+
     glm::vec3 center;
     float radius;
-    std::shared_ptr<Material> mat;
+    uint32_t material; // Index into the scene's MaterialTable
     AABB bbox;
 };
\ No newline at end of file
@@ -0,0 +1,279 @@
+#include "triangle_mesh.h"
+#include "stats/ray_stats.h"
+#include <algorithm>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define LUMI_TRIANGLE_SSE
+#endif
+
+TriangleMesh::TriangleMesh(std::vector<glm::vec3> positions, std::vector<uint32_t> indices, uint32_t material,
+                           std::vector<glm::vec3> normals, std::vector<glm::vec2> uvs, const BVHBuildOptions &options)
+    : positions(std::move(positions)), indices(std::move(indices)), normals(std::move(normals)), uvs(std::move(uvs)), materialIndex(material)
+{
+    if (this->indices.size() % 3 != 0)
+    {
+        std::cerr << "TriangleMesh: index count " << this->indices.size() << " is not a multiple of 3, truncating" << std::endl;
+        this->indices.resize(this->indices.size() - this->indices.size() % 3);
+    }
+    if (!this->normals.empty() && this->normals.size() != this->positions.size())
+        this->normals.clear();
+    if (!this->uvs.empty() && this->uvs.size() != this->positions.size())
+        this->uvs.clear();
+
+    std::vector<AABB> bounds(this->indices.size() / 3);
+    for (size_t triangle = 0; triangle < bounds.size(); triangle++)
+    {
+        const glm::vec3 &a = this->positions[this->indices[3 * triangle]];
+        const glm::vec3 &b = this->positions[this->indices[3 * triangle + 1]];
+        const glm::vec3 &c = this->positions[this->indices[3 * triangle + 2]];
+        bounds[triangle] = AABB(glm::min(glm::min(a, b), c), glm::max(glm::max(a, b), c));
+    }
+    bvh = LinearBVH(bounds, options);
+
+    // Store triangles in leaf order, after which the slot to triangle mapping is the identity
+    std::vector<uint32_t> ordered(this->indices.size());
+    for (size_t slot = 0; slot < bvh.primitiveIndices.size(); slot++)
+    {
+        uint32_t triangle = bvh.primitiveIndices[slot];
+        for (int corner = 0; corner < 3; corner++)
+            ordered[3 * slot + corner] = this->indices[3 * triangle + corner];
+    }
+    this->indices = std::move(ordered);
+    bvh.primitiveIndices.clear();
+    bvh.primitiveIndices.shrink_to_fit();
+
+    view.positions = this->positions.data();
+    view.indices = this->indices.data();
+    view.normals = this->normals.empty() ? nullptr : this->normals.data();
+    view.uvs = this->uvs.empty() ? nullptr : this->uvs.data();
+    view.nodes = bvh.nodes.data();
+    view.vertexCount = this->positions.size();
+    view.triangleCount = this->indices.size() / 3;
+    view.nodeCount = bvh.nodes.size();
+    bbox = bvh.boundingBox();
+}
+
+TriangleMesh::TriangleMesh(const Arrays &arrays, std::shared_ptr<const void> storage, uint32_t material)
+    : storage(std::move(storage)), view(arrays), bbox(AABB::empty), materialIndex(material)
+{
+    if (view.nodeCount > 0)
+        bbox = view.nodes[0].bounds().toAABB();
+
+    bvh.buildStats.nodeCount = view.nodeCount;
+    bvh.buildStats.primitiveCount = view.triangleCount;
+    // Parents come before their children, so a forward sweep sets every depth before it is read
+    std::vector<int> depths(view.nodeCount, 0);
+    for (size_t node = 0; node < view.nodeCount; node++)
+    {
+        const LinearBVHNode &current = view.nodes[node];
+        bvh.buildStats.leafCount += current.isLeaf() ? 1 : 0;
+        bvh.buildStats.depth = std::max(bvh.buildStats.depth, depths[node]);
+        if (!current.isLeaf())
+            depths[node + 1] = depths[current.offset] = depths[node] + 1;
+    }
+}
+
+BVHBuildOptions TriangleMesh::defaultBVHOptions()
+{
+    BVHBuildOptions options;
+    options.maxLeafSize = 8;
+    options.traversalCost = 2.0f;
+    return options;
+}
+
+AABB TriangleMesh::boundingBox() const { return bbox; }
+
+size_t TriangleMesh::memoryBytes() const
+{
+    return positions.capacity() * sizeof(glm::vec3) + indices.capacity() * sizeof(uint32_t) +
+           normals.capacity() * sizeof(glm::vec3) + uvs.capacity() * sizeof(glm::vec2) +
+           bvh.nodes.capacity() * sizeof(LinearBVHNode);
+}
+
+TriangleMesh::ShearedRay TriangleMesh::shearRay(const Ray &r)
+{
+    const glm::vec3 &direction = r.direction();
+    ShearedRay ray;
+    ray.origin = r.origin();
+    glm::vec3 magnitude = glm::abs(direction);
+    ray.kz = magnitude.x > magnitude.y ? (magnitude.x > magnitude.z ? 0 : 2) : (magnitude.y > magnitude.z ? 1 : 2);
+    ray.kx = (ray.kz + 1) % 3;
+    ray.ky = (ray.kx + 1) % 3;
+    // Keep the winding of the projected triangles independent of the direction's sign
+    if (direction[ray.kz] < 0)
+        std::swap(ray.kx, ray.ky);
+    ray.shearX = direction[ray.kx] / direction[ray.kz];
+    ray.shearY = direction[ray.ky] / direction[ray.kz];
+    ray.shearZ = 1.0f / direction[ray.kz];
+    return ray;
+}
+
+bool TriangleMesh::intersectTriangle(const ShearedRay &ray, uint32_t triangle, float tMin, float tMax, TriangleHit &hit) const
+{
+    const uint32_t *corner = &view.indices[3 * triangle];
+    const glm::vec3 a = view.positions[corner[0]] - ray.origin;
+    const glm::vec3 b = view.positions[corner[1]] - ray.origin;
+    const glm::vec3 c = view.positions[corner[2]] - ray.origin;
+
+    float ax = a[ray.kx] - ray.shearX * a[ray.kz];
+    float ay = a[ray.ky] - ray.shearY * a[ray.kz];
+    float bx = b[ray.kx] - ray.shearX * b[ray.kz];
+    float by = b[ray.ky] - ray.shearY * b[ray.kz];
+    float cx = c[ray.kx] - ray.shearX * c[ray.kz];
+    float cy = c[ray.ky] - ray.shearY * c[ray.kz];
+
+    float u = cx * by - cy * bx;
+    float v = ax * cy - ay * cx;
+    float w = bx * ay - by * ax;
+    if (u == 0.0f || v == 0.0f || w == 0.0f)
+    {
+        u = static_cast<float>(static_cast<double>(cx) * by - static_cast<double>(cy) * bx);
+        v = static_cast<float>(static_cast<double>(ax) * cy - static_cast<double>(ay) * cx);
+        w = static_cast<float>(static_cast<double>(bx) * ay - static_cast<double>(by) * ax);
+    }
+    if ((u < 0 || v < 0 || w < 0) && (u > 0 || v > 0 || w > 0))
+        return false;
+
+    float det = u + v + w;
+    if (det == 0.0f)
+        return false;
+
+    float t = (u * ray.shearZ * a[ray.kz] + v * ray.shearZ * b[ray.kz] + w * ray.shearZ * c[ray.kz]) / det;
+    if (!(t > tMin && t < tMax))
+        return false;
+
+    float invDet = 1.0f / det;
+    hit = {triangle, t, u * invDet, v * invDet, w * invDet};
+    return true;
+}
+
+bool TriangleMesh::intersectLeaf(const ShearedRay &ray, uint32_t first, uint32_t count, float tMin, float tMax, TriangleHit &best) const
+{
+    LUMI_STAT(primitiveTests, count);
+    bool hitAnything = false;
+#if defined(LUMI_TRIANGLE_SSE)
+    const __m128 shearX = _mm_set1_ps(ray.shearX), shearY = _mm_set1_ps(ray.shearY), shearZ = _mm_set1_ps(ray.shearZ);
+    const __m128 zero = _mm_setzero_ps();
+    for (uint32_t group = first; group < first + count; group += 4)
+    {
+        uint32_t lanes = std::min<uint32_t>(4, first + count - group);
+
+        // Gather the sheared vertices of up to four triangles, padding short groups with the first one
+        alignas(16) float vx[3][4], vy[3][4], vz[3][4];
+        for (uint32_t lane = 0; lane < 4; lane++)
+        {
+            uint32_t triangle = group + (lane < lanes ? lane : 0);
+            for (int corner = 0; corner < 3; corner++)
+            {
+                glm::vec3 p = view.positions[view.indices[3 * triangle + corner]] - ray.origin;
+                vx[corner][lane] = p[ray.kx];
+                vy[corner][lane] = p[ray.ky];
+                vz[corner][lane] = p[ray.kz];
+            }
+        }
+
+        __m128 az = _mm_load_ps(vz[0]), bz = _mm_load_ps(vz[1]), cz = _mm_load_ps(vz[2]);
+        __m128 ax = _mm_sub_ps(_mm_load_ps(vx[0]), _mm_mul_ps(shearX, az));
+        __m128 ay = _mm_sub_ps(_mm_load_ps(vy[0]), _mm_mul_ps(shearY, az));
+        __m128 bx = _mm_sub_ps(_mm_load_ps(vx[1]), _mm_mul_ps(shearX, bz));
+        __m128 by = _mm_sub_ps(_mm_load_ps(vy[1]), _mm_mul_ps(shearY, bz));
+        __m128 cx = _mm_sub_ps(_mm_load_ps(vx[2]), _mm_mul_ps(shearX, cz));
+        __m128 cy = _mm_sub_ps(_mm_load_ps(vy[2]), _mm_mul_ps(shearY, cz));
+
+        __m128 u = _mm_sub_ps(_mm_mul_ps(cx, by), _mm_mul_ps(cy, bx));
+        __m128 v = _mm_sub_ps(_mm_mul_ps(ax, cy), _mm_mul_ps(ay, cx));
+        __m128 w = _mm_sub_ps(_mm_mul_ps(bx, ay), _mm_mul_ps(by, ax));
+
+        // Lanes with an edge function of exactly zero are redone by the scalar test in double precision
+        __m128 onEdge = _mm_or_ps(_mm_or_ps(_mm_cmpeq_ps(u, zero), _mm_cmpeq_ps(v, zero)), _mm_cmpeq_ps(w, zero));
+        __m128 anyNegative = _mm_or_ps(_mm_or_ps(_mm_cmplt_ps(u, zero), _mm_cmplt_ps(v, zero)), _mm_cmplt_ps(w, zero));
+        __m128 anyPositive = _mm_or_ps(_mm_or_ps(_mm_cmpgt_ps(u, zero), _mm_cmpgt_ps(v, zero)), _mm_cmpgt_ps(w, zero));
+        __m128 inside = _mm_andnot_ps(_mm_and_ps(anyNegative, anyPositive), _mm_castsi128_ps(_mm_set1_epi32(-1)));
+
+        __m128 det = _mm_add_ps(_mm_add_ps(u, v), w);
+        __m128 scaledT = _mm_mul_ps(shearZ, _mm_add_ps(_mm_add_ps(_mm_mul_ps(u, az), _mm_mul_ps(v, bz)), _mm_mul_ps(w, cz)));
+        __m128 t = _mm_div_ps(scaledT, det);
+        __m128 valid = _mm_and_ps(inside, _mm_cmpneq_ps(det, zero));
+        valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpgt_ps(t, _mm_set1_ps(tMin)), _mm_cmplt_ps(t, _mm_set1_ps(tMax))));
+
+        int laneMask = (1 << lanes) - 1;
+        int edgeMask = _mm_movemask_ps(onEdge) & laneMask;
+        int hitMask = _mm_movemask_ps(valid) & laneMask & ~edgeMask;
+        if (!(hitMask | edgeMask))
+            continue;
+
+        alignas(16) float tLanes[4], uLanes[4], vLanes[4], wLanes[4], detLanes[4];
+        _mm_store_ps(tLanes, t);
+        _mm_store_ps(uLanes, u);
+        _mm_store_ps(vLanes, v);
+        _mm_store_ps(wLanes, w);
+        _mm_store_ps(detLanes, det);
+        for (uint32_t lane = 0; lane < lanes; lane++)
+        {
+            if (edgeMask & (1 << lane))
+            {
+                TriangleHit hit;
+                if (intersectTriangle(ray, group + lane, tMin, tMax, hit))
+                {
+                    best = hit;
+                    tMax = hit.t;
+                    hitAnything = true;
+                }
+            }
+            else if ((hitMask & (1 << lane)) && tLanes[lane] < tMax)
+            {
+                float invDet = 1.0f / detLanes[lane];
+                best = {group + lane, tLanes[lane], uLanes[lane] * invDet, vLanes[lane] * invDet, wLanes[lane] * invDet};
+                tMax = tLanes[lane];
+                hitAnything = true;
+            }
+        }
+    }
+#else
+    for (uint32_t triangle = first; triangle < first + count; triangle++)
+    {
+        TriangleHit hit;
+        if (intersectTriangle(ray, triangle, tMin, tMax, hit))
+        {
+            best = hit;
+            tMax = hit.t;
+            hitAnything = true;
+        }
+    }
+#endif
+    return hitAnything;
+}
+
+bool TriangleMesh::hit(const Ray &r, Interval rayT, HitRecord &rec) const
+{
+    ShearedRay ray = shearRay(r);
+    TriangleHit best;
+    auto intersectTriangles = [&](uint32_t first, uint32_t count, Interval &range)
+    {
+        if (!intersectLeaf(ray, first, count, static_cast<float>(range.min), static_cast<float>(range.max), best))
+            return false;
+        range.max = best.t;
+        return true;
+    };
+    if (view.nodeCount == 0 || !traverseLinearBVH(view.nodes, r, rayT, intersectTriangles))
+        return false;
+
+    // u, v, w weight the vertices opposite the edges they were computed from, i.e. a, b and c in order
+    const uint32_t *corner = &view.indices[3 * best.triangle];
+    const glm::vec3 &a = view.positions[corner[0]];
+    const glm::vec3 &b = view.positions[corner[1]];
+    const glm::vec3 &c = view.positions[corner[2]];
+
+    rec.t = best.t;
+    rec.point = best.b0 * a + best.b1 * b + best.b2 * c;
+    glm::vec3 outwardNormal;
+    if (view.normals == nullptr)
+        outwardNormal = glm::normalize(glm::cross(b - a, c - a));
+    else
+        outwardNormal = glm::normalize(best.b0 * view.normals[corner[0]] + best.b1 * view.normals[corner[1]] + best.b2 * view.normals[corner[2]]);
+    rec.setFaceNormal(r, outwardNormal);
+    rec.material = materialIndex;
+    return true;
+}
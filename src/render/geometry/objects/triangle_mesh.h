@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../hittable/hittable.h"
+#include "../bounding/aabb.h"
+#include "../bounding/linear_bvh.h"
+
+// Indexed triangle mesh stored as flat per-attribute arrays rather than one hittable per triangle, with its
+// own BVH over the triangles. Leaves are intersected with a watertight ray/triangle test, four triangles at a
+// time with SSE. Triangles are reordered into leaf order so a leaf's slots are its triangle indices.
+class TriangleMesh final : public Hittable
+{
+public:
+    // Flat arrays intersection reads from, either owned by the mesh or kept alive by external storage.
+    struct Arrays
+    {
+        const glm::vec3 *positions = nullptr;
+        const uint32_t *indices = nullptr; // Three per triangle, in BVH leaf order
+        const glm::vec3 *normals = nullptr; // Optional, per vertex
+        const glm::vec2 *uvs = nullptr;     // Optional, per vertex
+        const LinearBVHNode *nodes = nullptr;
+        size_t vertexCount = 0;
+        size_t triangleCount = 0;
+        size_t nodeCount = 0;
+    };
+
+    // indices holds three vertex indices per triangle, normals and uvs are optional per vertex attributes.
+    TriangleMesh(std::vector<glm::vec3> positions, std::vector<uint32_t> indices, uint32_t material,
+                 std::vector<glm::vec3> normals = {}, std::vector<glm::vec2> uvs = {},
+                 const BVHBuildOptions &options = defaultBVHOptions());
+
+    // Uses arrays of an already built mesh in place, e.g. sections of a mapped cache file owned by storage.
+    TriangleMesh(const Arrays &arrays, std::shared_ptr<const void> storage, uint32_t material);
+
+    // Views point into the mesh itself
+    TriangleMesh(const TriangleMesh &) = delete;
+    TriangleMesh &operator=(const TriangleMesh &) = delete;
+
+    bool hit(const Ray &r, Interval rayT, HitRecord &rec) const override;
+    AABB boundingBox() const override;
+
+    // Larger leaves than the scene BVH, since a leaf test covers four triangles for about the cost of one.
+    static BVHBuildOptions defaultBVHOptions();
+
+    size_t triangleCount() const { return view.triangleCount; }
+    size_t vertexCount() const { return view.vertexCount; }
+    const Arrays &arrays() const { return view; }
+    uint32_t material() const { return materialIndex; }
+    const BVHBuildStats &buildStats() const { return bvh.buildStats; }
+
+    // Heap bytes held by the vertex, index and hierarchy arrays, external storage is not counted.
+    size_t memoryBytes() const;
+
+private:
+    // Ray set up for the watertight test: the dominant direction axis becomes z and the others are sheared.
+    struct ShearedRay
+    {
+        glm::vec3 origin;
+        int kx, ky, kz;
+        float shearX, shearY, shearZ;
+    };
+
+    // Closest hit found so far within the mesh.
+    struct TriangleHit
+    {
+        uint32_t triangle;
+        float t;
+        float b0, b1, b2; // Barycentric weights of the triangle's three vertices
+    };
+
+    static ShearedRay shearRay(const Ray &r);
+
+    // Tests triangle slots [first, first + count) and records the closest hit inside (tMin, tMax).
+    bool intersectLeaf(const ShearedRay &ray, uint32_t first, uint32_t count, float tMin, float tMax, TriangleHit &best) const;
+
+    // One triangle, falling back to double precision on edges so neighbours never leave a gap between them.
+    bool intersectTriangle(const ShearedRay &ray, uint32_t triangle, float tMin, float tMax, TriangleHit &hit) const;
+
+    // Owned data, empty when the mesh views external storage
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> uvs;
+    LinearBVH bvh;
+
+    std::shared_ptr<const void> storage; // Keeps external arrays alive
+    Arrays view;
+    AABB bbox;
+    uint32_t materialIndex; // Index into the scene's MaterialTable
+};
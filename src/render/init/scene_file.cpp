@@ -0,0 +1,196 @@
+#include "scene_file.h"
+#include "geometry/hittable/transform.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+namespace
+{
+    bool readVec3(std::istringstream &line, glm::vec3 &value)
+    {
+        return static_cast<bool>(line >> value.x >> value.y >> value.z);
+    }
+
+    struct SceneParser
+    {
+        std::string path;
+        ThreadPool *pool = nullptr;
+        int lineNumber = 0;
+
+        std::optional<CamPos> camPos;
+        MaterialTable materials;
+        std::map<std::string, uint32_t> materialNames; // Index of each named material in materials
+        HittableList objects;
+        HittableList lights;
+        bool accelerate = false;
+
+        bool fail(const std::string &message) const
+        {
+            std::cerr << "Scene file " << path << ":" << lineNumber << ": " << message << std::endl;
+            return false;
+        }
+
+        bool readMaterial(std::istringstream &line, uint32_t &material) const
+        {
+            std::string name;
+            if (!(line >> name))
+                return fail("missing material name");
+            auto found = materialNames.find(name);
+            if (found == materialNames.end())
+                return fail("unknown material '" + name + "'");
+            material = found->second;
+            return true;
+        }
+
+        // Applies the modifiers after a primitive's arguments and adds it to the scene.
+        bool addPrimitive(std::istringstream &line, std::shared_ptr<Hittable> object)
+        {
+            AffineTransform objectToWorld;
+            bool transformed = false;
+            bool isLight = false;
+            std::string modifier;
+            while (line >> modifier)
+            {
+                glm::vec3 value;
+                if (modifier == "translate" && readVec3(line, value))
+                    objectToWorld = AffineTransform::translation(value) * objectToWorld;
+                else if (modifier == "scale" && readVec3(line, value))
+                    objectToWorld = AffineTransform::scale(value) * objectToWorld;
+                else if (modifier == "rotate_y" && line >> value.x)
+                    objectToWorld = AffineTransform::rotationY(value.x) * objectToWorld;
+                else if (modifier == "light")
+                {
+                    isLight = true;
+                    continue;
+                }
+                else
+                    return fail("bad modifier '" + modifier + "'");
+                transformed = true;
+            }
+
+            if (transformed)
+                object = std::make_shared<Transform>(object, objectToWorld);
+            objects.add(object);
+            if (isLight)
+                lights.add(object);
+            return true;
+        }
+
+        bool parseLine(const std::string &text)
+        {
+            std::istringstream line(text.substr(0, text.find('#')));
+            std::string keyword;
+            if (!(line >> keyword))
+                return true;
+
+            if (keyword == "camera")
+            {
+                glm::vec3 from, at, up;
+                float fov;
+                if (!readVec3(line, from) || !readVec3(line, at) || !readVec3(line, up) || !(line >> fov))
+                    return fail("expected camera <from> <at> <up> <fov>");
+                camPos.emplace(CamPos{from, at, up, fov});
+                return true;
+            }
+            if (keyword == "material")
+            {
+                std::string name, type;
+                glm::vec3 color;
+                if (!(line >> name >> type) || !readVec3(line, color))
+                    return fail("expected material <name> <type> <r g b>");
+                if (type == "lambertian")
+                    materialNames[name] = materials.add(std::make_shared<Lambertian>(color));
+                else if (type == "metal")
+                    materialNames[name] = materials.add(std::make_shared<Metal>(color));
+                else if (type == "light")
+                    materialNames[name] = materials.add(std::make_shared<DiffuseLight>(color));
+                else
+                    return fail("unknown material type '" + type + "'");
+                return true;
+            }
+            if (keyword == "sphere")
+            {
+                glm::vec3 center;
+                float radius;
+                uint32_t material;
+                if (!readVec3(line, center) || !(line >> radius))
+                    return fail("expected sphere <center> <radius> <material>");
+                return readMaterial(line, material) && addPrimitive(line, std::make_shared<Sphere>(center, radius, material));
+            }
+            if (keyword == "quad")
+            {
+                glm::vec3 corner, u, v;
+                uint32_t material;
+                if (!readVec3(line, corner) || !readVec3(line, u) || !readVec3(line, v))
+                    return fail("expected quad <corner> <u> <v> <material>");
+                return readMaterial(line, material) && addPrimitive(line, std::make_shared<Quad>(corner, u, v, material));
+            }
+            if (keyword == "box")
+            {
+                glm::vec3 a, b;
+                uint32_t material;
+                if (!readVec3(line, a) || !readVec3(line, b))
+                    return fail("expected box <corner> <opposite corner> <material>");
+                return readMaterial(line, material) && addPrimitive(line, Box(a, b, material));
+            }
+            if (keyword == "mesh")
+            {
+                std::string meshPath;
+                uint32_t material;
+                if (!(line >> meshPath))
+                    return fail("expected mesh <path> <material>");
+                if (!readMaterial(line, material))
+                    return false;
+                auto resolved = std::filesystem::path(path).parent_path() / meshPath;
+                auto mesh = loadTriangleMesh(resolved.string(), materials, material, pool);
+                if (!mesh)
+                    return fail("cannot load mesh '" + meshPath + "'");
+                return addPrimitive(line, mesh);
+            }
+            if (keyword == "bvh")
+            {
+                accelerate = true;
+                return true;
+            }
+            return fail("unknown statement '" + keyword + "'");
+        }
+    };
+}
+
+std::optional<World> loadSceneFile(const std::string &path, ThreadPool *pool)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cerr << "Cannot open scene file " << path << std::endl;
+        return std::nullopt;
+    }
+
+    SceneParser parser;
+    parser.path = path;
+    parser.pool = pool;
+    std::string text;
+    while (std::getline(file, text))
+    {
+        parser.lineNumber++;
+        if (!parser.parseLine(text))
+            return std::nullopt;
+    }
+    if (!parser.camPos)
+    {
+        parser.fail("no camera statement");
+        return std::nullopt;
+    }
+    if (parser.lights.objects.empty())
+    {
+        parser.fail("no primitive is marked as a light");
+        return std::nullopt;
+    }
+
+    HittableList objects = parser.objects;
+    if (parser.accelerate)
+        objects = HittableList(std::make_shared<BVHNode>(parser.objects));
+    return World(*parser.camPos, objects, parser.lights, parser.materials);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include "world.h"
+
+class ThreadPool;
+
+// Loads a scene from a text file, one statement per line, '#' starting a comment:
+//
+//   camera <from x y z> <at x y z> <up x y z> <vertical fov radians>
+//   material <name> lambertian|metal|light <r g b>
+//   sphere <center x y z> <radius> <material> [modifiers]
+//   quad <corner x y z> <u x y z> <v x y z> <material> [modifiers]
+//   box <corner x y z> <opposite corner x y z> <material> [modifiers]
+//   mesh <OBJ or PLY path, relative to the scene file> <material> [modifiers]
+//   bvh
+//
+// Modifiers apply in the order given: "translate x y z", "rotate_y radians", "scale x y z", plus "light"
+// to also sample the primitive as a light. "bvh" accelerates the scene's objects with a BVH.
+// Meshes load and build on pool when given. Prints the offending line and returns nothing on errors.
+std::optional<World> loadSceneFile(const std::string &path, ThreadPool *pool = nullptr);
@@ -0,0 +1,43 @@
+#include "scene_registry.h"
+#include "scene_file.h"
+
+SceneRegistry &SceneRegistry::builtin()
+{
+    static SceneRegistry registry = []
+    {
+        SceneRegistry scenes;
+        scenes.add("cornell", [](ThreadPool *) { return cornellBoxWorld(); });
+        scenes.add("lit", [](ThreadPool *) { return litWorld(); });
+        scenes.add("spheres", [](ThreadPool *) { return sphereWorld(); });
+        scenes.add("spheres400", [](ThreadPool *pool)
+        {
+            BVHBuildOptions options;
+            options.pool = pool;
+            return complexSphereWorld(options);
+        });
+        scenes.add("quads", [](ThreadPool *) { return quadWorld(); });
+        return scenes;
+    }();
+    return registry;
+}
+
+void SceneRegistry::add(const std::string &name, Factory factory)
+{
+    factories[name] = std::move(factory);
+}
+
+std::optional<World> SceneRegistry::create(const std::string &name, ThreadPool *pool) const
+{
+    auto found = factories.find(name);
+    if (found != factories.end())
+        return found->second(pool);
+    return loadSceneFile(name, pool);
+}
+
+std::vector<std::string> SceneRegistry::names() const
+{
+    std::vector<std::string> result;
+    for (const auto &[name, factory] : factories)
+        result.push_back(name);
+    return result;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+#include "world.h"
+
+class ThreadPool;
+
+// Name based registry of scenes. Registering stores only a factory, so no scene is constructed until it is
+// requested and only the requested one is. Names that are not registered are loaded as scene files.
+class SceneRegistry
+{
+public:
+    using Factory = std::function<World(ThreadPool *pool)>;
+
+    // Registry with the built-in scenes: "cornell", "lit", "spheres", "spheres400" and "quads".
+    static SceneRegistry &builtin();
+
+    void add(const std::string &name, Factory factory);
+
+    // Builds the named scene, or loads name as a scene file path. Meshes load and build on pool when given.
+    std::optional<World> create(const std::string &name, ThreadPool *pool = nullptr) const;
+
+    std::vector<std::string> names() const;
+
+private:
+    std::map<std::string, Factory> factories;
+};
@@ -1,19 +1,28 @@
 #include "world.h"
 
+// Square area light facing down, centered above a scene that has no light of its own.
+HittableList overheadLight(MaterialTable &materials, const glm::vec3 &center, float size, const glm::vec3 &radiance)
+{
+    HittableList lights;
+    auto light = materials.add(std::make_shared<DiffuseLight>(radiance));
+    lights.add(std::make_shared<Quad>(center - glm::vec3(size / 2, 0, size / 2), glm::vec3(size, 0, 0), glm::vec3(0, 0, size), light));
+    return lights;
+}
+
 const CamPos CAM_POS_SPHERES{
     glm::vec3(-3.0f, 3.0f, 1.0f),
     glm::vec3(0.0f, 0.0f, 0.0f),
     glm::vec3(0.0f, 1.0f, 0.0f),
     1.2f};
 
-HittableList sphereWorldObjs()
+HittableList sphereWorldObjs(MaterialTable &materials)
 {
     HittableList world;
 
-    auto material_ground = std::make_shared<Lambertian>(glm::vec3(0.1f, 0.2f, 0.5f));
-    auto material_center = std::make_shared<Lambertian>(glm::vec3(0.76f, 0.13f, 0.89f));
-    auto material_left = std::make_shared<Metal>(glm::vec3(0.8f, 0.8f, 0.8f));
-    auto material_right = std::make_shared<Metal>(glm::vec3(0.8f, 0.6f, 0.2f));
+    auto material_ground = materials.add(std::make_shared<Lambertian>(glm::vec3(0.1f, 0.2f, 0.5f)));
+    auto material_center = materials.add(std::make_shared<Lambertian>(glm::vec3(0.76f, 0.13f, 0.89f)));
+    auto material_left = materials.add(std::make_shared<Metal>(glm::vec3(0.8f, 0.8f, 0.8f)));
+    auto material_right = materials.add(std::make_shared<Metal>(glm::vec3(0.8f, 0.6f, 0.2f)));
 
     world.add(std::make_shared<Sphere>(glm::vec3(0, 0, -1.0f), 0.5f, material_center));
     world.add(std::make_shared<Sphere>(glm::vec3(0, -1000.5f, -1), 1000.0f, material_ground));
@@ -23,11 +32,29 @@ HittableList sphereWorldObjs()
     return world;
 }
 
-HittableList complexSphereWorldObjs()
+World sphereWorld()
+{
+    MaterialTable materials;
+    HittableList lights = overheadLight(materials, glm::vec3(0, 3, -1), 2, glm::vec3(8, 8, 8));
+    HittableList objects = sphereWorldObjs(materials);
+    objects += lights;
+    return World(CAM_POS_SPHERES, objects, lights, materials);
+}
+
+const CamPos CAM_POS_COMPLEX_SPHERES{
+    glm::vec3(13.0f, 2.0f, 3.0f),
+    glm::vec3(0.0f, 0.0f, 0.0f),
+    glm::vec3(0.0f, 1.0f, 0.0f),
+    0.35f};
+
+HittableList complexSphereWorldObjs(MaterialTable &materials, const BVHBuildOptions &bvhOptions, BVHBuildStats *buildStats)
 {
+    // Restart the scene generator so the spheres are the same however often the scene is built
+    Utils::Random::threadRNG() = Utils::Random::RNG();
+
     HittableList world;
 
-    auto ground_material = std::make_shared<Lambertian>(glm::vec3(0.5, 0.5, 0.5));
+    auto ground_material = materials.add(std::make_shared<Lambertian>(glm::vec3(0.5, 0.5, 0.5)));
     world.add(std::make_shared<Sphere>(glm::vec3(0, -1000, 0), 1000, ground_material));
 
     for (int a = -11; a < 11; a++)
@@ -39,34 +66,51 @@ HittableList complexSphereWorldObjs()
 
             if (glm::length(center - glm::vec3(4, 0.2, 0)) > 0.9)
             {
-                std::shared_ptr<Material> sphere_material;
+                uint32_t sphere_material;
 
                 if (choose_mat < 0.8)
                 {
                     // Albedo
                     auto albedo = glm::vec3(Utils::Random::randomDouble(), Utils::Random::randomDouble(), Utils::Random::randomDouble());
-                    sphere_material = std::make_shared<Lambertian>(albedo);
+                    sphere_material = materials.add(std::make_shared<Lambertian>(albedo));
                     world.add(std::make_shared<Sphere>(center, 0.2, sphere_material));
                 }
                 else
                 {
                     // Metal
                     auto albedo = glm::vec3(Utils::Random::randomDouble(0.5, 1), Utils::Random::randomDouble(0.5, 1), Utils::Random::randomDouble(0.5, 1));
-                    sphere_material = std::make_shared<Metal>(albedo);
+                    sphere_material = materials.add(std::make_shared<Metal>(albedo));
                     world.add(std::make_shared<Sphere>(center, 0.2, sphere_material));
                 }
             }
         }
     }
 
-    auto material1 = std::make_shared<Lambertian>(glm::vec3(0.4, 0.2, 0.1));
+    auto material1 = materials.add(std::make_shared<Lambertian>(glm::vec3(0.4, 0.2, 0.1)));
     world.add(std::make_shared<Sphere>(glm::vec3(-4, 1, 0), 1.0, material1));
 
-    auto material2 = std::make_shared<Metal>(glm::vec3(0.7, 0.6, 0.5));
+    auto material2 = materials.add(std::make_shared<Metal>(glm::vec3(0.7, 0.6, 0.5)));
     world.add(std::make_shared<Sphere>(glm::vec3(4, 1, 0), 1.0, material2));
 
     // Accelerate
-    world = HittableList(std::make_shared<BVHNode>(world));
+    auto bvh = std::make_shared<BVHNode>(world, bvhOptions);
+    if (buildStats)
+        *buildStats = bvh->buildStats();
+
+    world = HittableList(bvh);
+    return world;
+}
+
+World complexSphereWorld(const BVHBuildOptions &bvhOptions)
+{
+    // The light stays outside the BVH so the BVH build options alone decide the spheres' hierarchy
+    MaterialTable materials;
+    HittableList lights = overheadLight(materials, glm::vec3(0, 8, 0), 6, glm::vec3(6, 6, 6));
+    BVHBuildStats bvhStats;
+    HittableList objects = complexSphereWorldObjs(materials, bvhOptions, &bvhStats);
+    objects += lights;
+    World world(CAM_POS_COMPLEX_SPHERES, objects, lights, materials);
+    world.bvhStats = bvhStats;
     return world;
 }
 
@@ -76,16 +120,16 @@ const CamPos CAM_POS_QUAD{
     glm::vec3(0.0f, 1.0f, 0.0f),
     1.4f};
 
-HittableList quadWorldObjs()
+HittableList quadWorldObjs(MaterialTable &materials)
 {
     HittableList world;
 
     // Materials
-    auto left_red = std::make_shared<Lambertian>(glm::vec3(1.0f, 0.2f, 0.2f));
-    auto back_green = std::make_shared<Lambertian>(glm::vec3(0.2f, 1.0f, 0.2f));
-    auto right_blue = std::make_shared<Lambertian>(glm::vec3(0.2f, 0.2f, 1.0f));
-    auto upper_orange = std::make_shared<Lambertian>(glm::vec3(1.0f, 0.5f, 0.0f));
-    auto lower_teal = std::make_shared<Lambertian>(glm::vec3(0.2f, 0.8f, 0.8f));
+    auto left_red = materials.add(std::make_shared<Lambertian>(glm::vec3(1.0f, 0.2f, 0.2f)));
+    auto back_green = materials.add(std::make_shared<Lambertian>(glm::vec3(0.2f, 1.0f, 0.2f)));
+    auto right_blue = materials.add(std::make_shared<Lambertian>(glm::vec3(0.2f, 0.2f, 1.0f)));
+    auto upper_orange = materials.add(std::make_shared<Lambertian>(glm::vec3(1.0f, 0.5f, 0.0f)));
+    auto lower_teal = materials.add(std::make_shared<Lambertian>(glm::vec3(0.2f, 0.8f, 0.8f)));
 
     // Quads
     world.add(std::make_shared<Quad>(glm::vec3(-3, -2, 5), glm::vec3(0, 0, -4), glm::vec3(0, 4, 0), left_red));
@@ -97,6 +141,15 @@ HittableList quadWorldObjs()
     return world;
 }
 
+World quadWorld()
+{
+    MaterialTable materials;
+    HittableList lights = overheadLight(materials, glm::vec3(0, 2.9f, 3), 1.5f, glm::vec3(10, 10, 10));
+    HittableList objects = quadWorldObjs(materials);
+    objects += lights;
+    return World(CAM_POS_QUAD, objects, lights, materials);
+}
+
 //////////////////////////
 
 const CamPos CAM_POS_LIT{
@@ -105,12 +158,12 @@ const CamPos CAM_POS_LIT{
     glm::vec3(0.0f, 1.0f, 0.0f),
     0.35f};
 
-HittableList litWorldObjs()
+HittableList litWorldObjs(MaterialTable &materials)
 {
     HittableList world;
 
-    auto material = std::make_shared<Lambertian>(glm::vec3(0.4, 0.2, 0.1));
-    auto metal = std::make_shared<Metal>(glm::vec3(0.7, 0.7, 0.7));
+    auto material = materials.add(std::make_shared<Lambertian>(glm::vec3(0.4, 0.2, 0.1)));
+    auto metal = materials.add(std::make_shared<Metal>(glm::vec3(0.7, 0.7, 0.7)));
 
     world.add(std::make_shared<Sphere>(glm::vec3(0, -1000, 0), 1000, material));
     world.add(std::make_shared<Sphere>(glm::vec3(0, 2, 0), 2, metal));
@@ -118,18 +171,24 @@ HittableList litWorldObjs()
     return world;
 }
 
-HittableList litWorldLights()
+HittableList litWorldLights(MaterialTable &materials)
 {
     HittableList lights;
-    auto difflight = std::make_shared<DiffuseLight>(glm::vec3(4, 4, 4));
-    auto bluelight = std::make_shared<DiffuseLight>(glm::vec3(0.5f, 0.5f, 6));
+    auto difflight = materials.add(std::make_shared<DiffuseLight>(glm::vec3(4, 4, 4)));
+    auto bluelight = materials.add(std::make_shared<DiffuseLight>(glm::vec3(0.5f, 0.5f, 6)));
     lights.add(std::make_shared<Quad>(glm::vec3(3, 1, -2), glm::vec3(2, 0, 0), glm::vec3(0, 2, 0), bluelight));
     lights.add(std::make_shared<Sphere>(glm::vec3(0, 7, 0), 2, difflight));
 
     return lights;
 }
 
-const World litWorld = World(CAM_POS_LIT, litWorldObjs(), litWorldLights());
+World litWorld()
+{
+    MaterialTable materials;
+    HittableList objects = litWorldObjs(materials);
+    HittableList lights = litWorldLights(materials);
+    return World(CAM_POS_LIT, objects, lights, materials);
+}
 
 //////////////////////////
 
@@ -139,13 +198,13 @@ const CamPos CAM_POS_CORNELL_BOX{
     glm::vec3(0, 1, 0),
     0.7f};
 
-HittableList cornellBoxObjs()
+HittableList cornellBoxObjs(MaterialTable &materials)
 {
     HittableList world;
 
-    auto red = std::make_shared<Lambertian>(glm::vec3(0.65f, 0.05f, 0.05f));
-    auto white = std::make_shared<Lambertian>(glm::vec3(.73, .73, .73));
-    auto green = std::make_shared<Lambertian>(glm::vec3(.12, .45, .15));
+    auto red = materials.add(std::make_shared<Lambertian>(glm::vec3(0.65f, 0.05f, 0.05f)));
+    auto white = materials.add(std::make_shared<Lambertian>(glm::vec3(.73, .73, .73)));
+    auto green = materials.add(std::make_shared<Lambertian>(glm::vec3(.12, .45, .15)));
 
     // Room
     world.add(std::make_shared<Quad>(glm::vec3(555, 0, 0), glm::vec3(0, 555, 0), glm::vec3(0, 0, 555), green));
@@ -154,29 +213,68 @@ HittableList cornellBoxObjs()
     world.add(std::make_shared<Quad>(glm::vec3(555, 555, 555), glm::vec3(-555, 0, 0), glm::vec3(0, 0, -555), white));
     world.add(std::make_shared<Quad>(glm::vec3(0, 0, 555), glm::vec3(555, 0, 0), glm::vec3(0, 555, 0), white));
 
-    // Boxes
-    std::shared_ptr<Hittable> box1 = Box(glm::vec3(0, 0, 0), glm::vec3(165, 330, 165), white);
-    box1 = std::make_shared<RotateY>(box1, 0.26);
-    box1 = std::make_shared<Translate>(box1, glm::vec3(265, 0, 295));
-    world.add(box1);
-
-    std::shared_ptr<Hittable> box2 = Box(glm::vec3(0, 0, 0), glm::vec3(165, 165, 165), white);
-    box2 = std::make_shared<RotateY>(box2, -0.31);
-    box2 = std::make_shared<Translate>(box2, glm::vec3(130, 0, 65));
-    world.add(box2);
+    // Boxes, instances of one unit box under a top-level BVH
+    auto unitBox = std::make_shared<BVHNode>(*Box(glm::vec3(0, 0, 0), glm::vec3(1, 1, 1), white));
+    HittableList boxes;
+    boxes.add(std::make_shared<Instance>(unitBox, AffineTransform::translation(glm::vec3(265, 0, 295)) *
+                                                      AffineTransform::rotationY(0.26f) *
+                                                      AffineTransform::scale(glm::vec3(165, 330, 165))));
+    boxes.add(std::make_shared<Instance>(unitBox, AffineTransform::translation(glm::vec3(130, 0, 65)) *
+                                                      AffineTransform::rotationY(-0.31f) *
+                                                      AffineTransform::scale(glm::vec3(165, 165, 165))));
+    world.add(std::make_shared<BVHNode>(boxes));
 
     return world;
 }
 
-HittableList cornellBoxLights()
+HittableList cornellBoxLights(MaterialTable &materials)
 {
     HittableList lights;
 
-    auto light = std::make_shared<DiffuseLight>(glm::vec3(15, 15, 15));
-    auto empty_material = std::shared_ptr<Material>();
+    auto light = materials.add(std::make_shared<DiffuseLight>(glm::vec3(15, 15, 15)));
     lights.add(std::make_shared<Quad>(glm::vec3(343, 554, 332), glm::vec3(-130, 0, 0), glm::vec3(0, 0, -105), light));
     return lights;
 }
 
-// Check why need to do this
-const World cornellBox = World(CAM_POS_CORNELL_BOX, cornellBoxObjs() += cornellBoxLights(), cornellBoxLights());
\ No newline at end of file
+World cornellBoxWorld()
+{
+    // The light is in both lists: objects make it visible, lights make it sampled
+    MaterialTable materials;
+    HittableList lights = cornellBoxLights(materials);
+    HittableList objects = cornellBoxObjs(materials);
+    objects += lights;
+    return World(CAM_POS_CORNELL_BOX, objects, lights, materials);
+}
+
+//////////////////////////
+
+std::optional<World> meshWorld(const std::string &path, ThreadPool *pool)
+{
+    MaterialTable materials;
+    auto white = materials.add(std::make_shared<Lambertian>(glm::vec3(.73, .73, .73)));
+    auto mesh = loadTriangleMesh(path, materials, white, pool);
+    if (!mesh)
+        return std::nullopt;
+
+    AABB bounds = mesh->boundingBox();
+    glm::vec3 min(bounds.x.min, bounds.y.min, bounds.z.min);
+    glm::vec3 max(bounds.x.max, bounds.y.max, bounds.z.max);
+    glm::vec3 center = 0.5f * (min + max);
+    float radius = 0.5f * glm::length(max - min);
+
+    const CamPos camPos{
+        center + glm::vec3(0, 0.5f * radius, 3.0f * radius),
+        center,
+        glm::vec3(0, 1, 0),
+        0.7f};
+
+    HittableList lights;
+    auto light = materials.add(std::make_shared<DiffuseLight>(glm::vec3(6, 6, 6)));
+    lights.add(std::make_shared<Quad>(center + glm::vec3(-radius, 2 * radius, -radius), glm::vec3(2 * radius, 0, 0), glm::vec3(0, 0, 2 * radius), light));
+
+    HittableList objects(mesh);
+    objects += lights;
+    World world(camPos, objects, lights, materials);
+    world.bvhStats = mesh->buildStats();
+    return world;
+}
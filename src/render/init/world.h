@@ -3,9 +3,15 @@
 #include "utils.h"
 #include "geometry/hittable/hittable_list.h"
 #include "geometry/bounding/bvh.h"
+#include "geometry/hittable/instance.h"
 #include "material/material.h"
+#include "material/material_table.h"
 #include "geometry/objects/sphere.h"
 #include "geometry/objects/quad.h"
+#include "geometry/objects/primitive_arrays.h"
+#include "io/mesh_loader.h"
+#include <optional>
+#include <string>
 
 // Structure representing camera parameters for different scenes.
 struct CamPos
@@ -18,13 +24,46 @@ struct CamPos
 
 struct World
 {
-    World(const CamPos &cam_pos, const HittableList &objs, const HittableList &lights) : camPos(cam_pos), objects(objs), lights(lights) {}
+    // Translate/RotateY chains in the scene are collapsed into single transforms, then the objects are
+    // compiled into primitive arrays for rendering.
+    World(const CamPos &cam_pos, const HittableList &objs, const HittableList &lights, MaterialTable materials)
+        : camPos(cam_pos), objects(objs), lights(lights), materials(std::move(materials))
+    {
+        collapseTransforms(objects);
+        collapseTransforms(this->lights);
+        root = primitives.add(objects);
+    }
+
+    // Closest hit in the scene, found through the compiled primitives without virtual calls.
+    bool hit(const Ray &r, Interval rayT, HitRecord &rec) const { return primitives.hit(root, r, rayT, rec); }
 
     CamPos camPos;
-    HittableList objects;
+    HittableList objects; // Authoring objects, compiled once on construction
     HittableList lights;
+    MaterialTable materials; // Every material index in objects and lights refers to this table
+    PrimitiveArrays primitives;
+    PrimitiveRef root; // Group of all objects
+
+    BVHBuildStats bvhStats; // Build of the scene's main BVH or mesh, zero for scenes without one
 };
 
-HittableList cornellBoxObjs();
-extern const World litWorld;
-extern const World cornellBox;
\ No newline at end of file
+// Scene contents are built with their materials added to the given table.
+HittableList cornellBoxObjs(MaterialTable &materials);
+
+// Ground plane with a grid of ~400 small random spheres, accelerated with a BVH built using bvhOptions.
+// buildStats, when given, receives the statistics of that build.
+HittableList complexSphereWorldObjs(MaterialTable &materials, const BVHBuildOptions &bvhOptions = BVHBuildOptions(),
+                                    BVHBuildStats *buildStats = nullptr);
+
+// Built-in scenes, constructed only when called. Use SceneRegistry to look scenes up by name.
+World litWorld();
+World cornellBoxWorld();
+
+// Four spheres, ~400 spheres behind a BVH built with bvhOptions, and five quads, each lit by an overhead area light.
+World sphereWorld();
+World complexSphereWorld(const BVHBuildOptions &bvhOptions = BVHBuildOptions());
+World quadWorld();
+
+// A mesh file (OBJ or binary PLY) framed by the camera and lit from above, loaded and accelerated on pool.
+// Empty when the file cannot be loaded.
+std::optional<World> meshWorld(const std::string &path, ThreadPool *pool = nullptr);
\ No newline at end of file
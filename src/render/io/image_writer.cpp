@@ -0,0 +1,177 @@
+#include "image_writer.h"
+#include "utils.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    const std::array<uint32_t, 256> &crcTable()
+    {
+        static const std::array<uint32_t, 256> table = []
+        {
+            std::array<uint32_t, 256> result{};
+            for (uint32_t n = 0; n < 256; n++)
+            {
+                uint32_t c = n;
+                for (int k = 0; k < 8; k++)
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                result[n] = c;
+            }
+            return result;
+        }();
+        return table;
+    }
+
+    void appendBigEndian(std::vector<uint8_t> &out, uint32_t value)
+    {
+        out.push_back(static_cast<uint8_t>(value >> 24));
+        out.push_back(static_cast<uint8_t>(value >> 16));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    void writeChunk(std::ofstream &file, const char type[4], const std::vector<uint8_t> &data)
+    {
+        std::vector<uint8_t> chunk;
+        appendBigEndian(chunk, static_cast<uint32_t>(data.size()));
+        chunk.insert(chunk.end(), type, type + 4);
+        chunk.insert(chunk.end(), data.begin(), data.end());
+
+        // The CRC covers the type and the data, not the length
+        uint32_t crc = 0xFFFFFFFFu;
+        for (size_t i = 4; i < chunk.size(); i++)
+            crc = crcTable()[(crc ^ chunk[i]) & 0xFF] ^ (crc >> 8);
+        appendBigEndian(chunk, crc ^ 0xFFFFFFFFu);
+        file.write(reinterpret_cast<const char *>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+    }
+
+    // Wraps data in a zlib stream of stored (uncompressed) deflate blocks, which every PNG reader accepts.
+    std::vector<uint8_t> zlibStored(const std::vector<uint8_t> &data)
+    {
+        const size_t maxBlock = 65535;
+        std::vector<uint8_t> out = {0x78, 0x01};
+        size_t offset = 0;
+        do
+        {
+            size_t length = std::min(maxBlock, data.size() - offset);
+            bool last = offset + length == data.size();
+            out.push_back(last ? 1 : 0);
+            out.push_back(static_cast<uint8_t>(length));
+            out.push_back(static_cast<uint8_t>(length >> 8));
+            out.push_back(static_cast<uint8_t>(~length));
+            out.push_back(static_cast<uint8_t>(~length >> 8));
+            out.insert(out.end(), data.begin() + offset, data.begin() + offset + length);
+            offset += length;
+        } while (offset < data.size());
+
+        uint32_t a = 1, b = 0;
+        for (uint8_t byte : data)
+        {
+            a = (a + byte) % 65521;
+            b = (b + a) % 65521;
+        }
+        appendBigEndian(out, (b << 16) | a);
+        return out;
+    }
+
+    bool checkSize(const std::string &path, int width, int height, const std::vector<glm::vec3> &image)
+    {
+        if (width <= 0 || height <= 0 || image.size() != static_cast<size_t>(width) * height)
+        {
+            std::cerr << "Cannot write " << path << ": image is not " << width << "x" << height << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
+
+bool writePNG(const std::string &path, int width, int height, const std::vector<glm::vec3> &image, bool gammaCorrect)
+{
+    if (!checkSize(path, width, height, image))
+        return false;
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "Cannot open " << path << " for writing" << std::endl;
+        return false;
+    }
+
+    // Every scanline starts with filter type 0 (none), PNG stores the top row first
+    std::vector<uint8_t> scanlines;
+    scanlines.reserve(static_cast<size_t>(height) * (1 + 3 * static_cast<size_t>(width)));
+    for (int y = height - 1; y >= 0; y--)
+    {
+        scanlines.push_back(0);
+        for (int x = 0; x < width; x++)
+        {
+            glm::vec3 color = image[static_cast<size_t>(y) * width + x];
+            if (gammaCorrect)
+                color = Utils::Color::linearToGamma(color);
+            for (int c = 0; c < 3; c++)
+                scanlines.push_back(static_cast<uint8_t>(std::clamp(color[c], 0.0f, 1.0f) * 255.0f + 0.5f));
+        }
+    }
+
+    std::vector<uint8_t> header;
+    appendBigEndian(header, static_cast<uint32_t>(width));
+    appendBigEndian(header, static_cast<uint32_t>(height));
+    header.insert(header.end(), {8, 2, 0, 0, 0}); // 8-bit RGB, deflate, no filtering choice, no interlace
+
+    const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    file.write(reinterpret_cast<const char *>(signature), sizeof(signature));
+    writeChunk(file, "IHDR", header);
+    writeChunk(file, "IDAT", zlibStored(scanlines));
+    writeChunk(file, "IEND", {});
+    return static_cast<bool>(file);
+}
+
+bool writePFM(const std::string &path, int width, int height, const std::vector<glm::vec3> &image)
+{
+    if (!checkSize(path, width, height, image))
+        return false;
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "Cannot open " << path << " for writing" << std::endl;
+        return false;
+    }
+
+    // A negative scale marks little-endian data, PFM stores the bottom row first like the image
+    file << "PF\n"
+         << width << " " << height << "\n-1.0\n";
+    std::vector<float> row(3 * static_cast<size_t>(width));
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            const glm::vec3 &color = image[static_cast<size_t>(y) * width + x];
+            for (int c = 0; c < 3; c++)
+            {
+                float value = color[c];
+                uint32_t bits;
+                std::memcpy(&bits, &value, sizeof(bits));
+                uint8_t *bytes = reinterpret_cast<uint8_t *>(&row[3 * x + c]);
+                for (int i = 0; i < 4; i++)
+                    bytes[i] = static_cast<uint8_t>(bits >> (8 * i));
+            }
+        }
+        file.write(reinterpret_cast<const char *>(row.data()), static_cast<std::streamsize>(row.size() * sizeof(float)));
+    }
+    return static_cast<bool>(file);
+}
+
+bool writeImage(const std::string &path, int width, int height, const std::vector<glm::vec3> &image)
+{
+    auto dot = path.find_last_of('.');
+    std::string extension = dot == std::string::npos ? "" : path.substr(dot);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c)
+                   { return static_cast<char>(std::tolower(c)); });
+    if (extension == ".pfm")
+        return writePFM(path, width, height, image);
+    return writePNG(path, width, height, image);
+}
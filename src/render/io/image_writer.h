@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Images are linear radiance, width * height pixels with the bottom row first (the order the renderer
+// accumulates in and OpenGL textures use).
+
+// Writes an 8-bit RGB PNG, clamped and gamma corrected like the viewer displays it unless gammaCorrect is
+// false (for images that already hold display colors, such as heatmaps).
+bool writePNG(const std::string &path, int width, int height, const std::vector<glm::vec3> &image, bool gammaCorrect = true);
+
+// Writes a little-endian RGB Portable Float Map, keeping the full linear range.
+bool writePFM(const std::string &path, int width, int height, const std::vector<glm::vec3> &image);
+
+// Writes PNG or PFM depending on the extension of path (".pfm" is linear, anything else is PNG).
+bool writeImage(const std::string &path, int width, int height, const std::vector<glm::vec3> &image);
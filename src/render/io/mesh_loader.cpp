@@ -0,0 +1,910 @@
+#include "mesh_loader.h"
+#include "mapped_file.h"
+#include "scene_cache.h"
+#include "parallel/thread_pool.h"
+#include "stats/profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+
+namespace
+{
+    // Runs body(chunk) for every chunk, on the pool when there is more than one.
+    template <typename Body>
+    void forEachChunk(ThreadPool *pool, size_t chunkCount, Body &&body)
+    {
+        if (pool == nullptr || chunkCount == 1)
+        {
+            for (size_t chunk = 0; chunk < chunkCount; chunk++)
+                body(chunk);
+            return;
+        }
+        pool->parallelFor(chunkCount, body);
+    }
+
+    // Splits count items into chunks of roughly chunkSize, at most a few per thread.
+    size_t chunkCountFor(ThreadPool *pool, size_t count, size_t chunkSize)
+    {
+        if (pool == nullptr)
+            return 1;
+        size_t chunks = std::min<size_t>(count / chunkSize, pool->threadCount() * 4);
+        return std::max<size_t>(chunks, 1);
+    }
+
+    ////////////////////////// Text parsing
+
+    bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+    bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+    void skipBlanks(const char *&p, const char *end)
+    {
+        while (p < end && isBlank(*p))
+            p++;
+    }
+
+    void skipLine(const char *&p, const char *end)
+    {
+        const char *newline = static_cast<const char *>(std::memchr(p, '\n', end - p));
+        p = newline ? newline + 1 : end;
+    }
+
+    // Whether p is at the end of a line's data, i.e. a newline, a comment or the end of the input.
+    bool atLineEnd(const char *p, const char *end)
+    {
+        return p >= end || *p == '\n' || *p == '#';
+    }
+
+    bool parseInteger(const char *&p, const char *end, int64_t &value)
+    {
+        const char *cursor = p;
+        bool negative = false;
+        if (cursor < end && (*cursor == '-' || *cursor == '+'))
+            negative = *cursor++ == '-';
+        if (cursor >= end || !isDigit(*cursor))
+            return false;
+
+        int64_t result = 0;
+        while (cursor < end && isDigit(*cursor))
+            result = result * 10 + (*cursor++ - '0');
+        value = negative ? -result : result;
+        p = cursor;
+        return true;
+    }
+
+    // Decimal float parser working directly on the mapped bytes: the digits are gathered into a 64-bit
+    // integer and scaled once by an exact power of ten, which is within an ulp of a correctly rounded float.
+    bool parseFloat(const char *&p, const char *end, float &value)
+    {
+        static const double powersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                             1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        const char *cursor = p;
+        bool negative = false;
+        if (cursor < end && (*cursor == '-' || *cursor == '+'))
+            negative = *cursor++ == '-';
+
+        uint64_t mantissa = 0;
+        int significantDigits = 0;
+        int exponent = 0;
+        bool sawDigit = false;
+        while (cursor < end && isDigit(*cursor))
+        {
+            sawDigit = true;
+            int digit = *cursor++ - '0';
+            if (significantDigits < 19)
+            {
+                mantissa = mantissa * 10 + digit;
+                significantDigits += mantissa != 0 ? 1 : 0;
+            }
+            else
+                exponent++;
+        }
+        if (cursor < end && *cursor == '.')
+        {
+            cursor++;
+            while (cursor < end && isDigit(*cursor))
+            {
+                sawDigit = true;
+                int digit = *cursor++ - '0';
+                if (significantDigits < 19)
+                {
+                    mantissa = mantissa * 10 + digit;
+                    significantDigits += mantissa != 0 ? 1 : 0;
+                    exponent--;
+                }
+            }
+        }
+        if (!sawDigit)
+            return false;
+
+        if (cursor < end && (*cursor == 'e' || *cursor == 'E'))
+        {
+            const char *exponentStart = cursor + 1;
+            int64_t exponentValue;
+            if (parseInteger(exponentStart, end, exponentValue))
+            {
+                exponent += static_cast<int>(std::clamp<int64_t>(exponentValue, -1000, 1000));
+                cursor = exponentStart;
+            }
+        }
+
+        double result = static_cast<double>(mantissa);
+        if (exponent < 0)
+            result = exponent >= -22 ? result / powersOfTen[-exponent] : result * std::pow(10.0, exponent);
+        else if (exponent > 0)
+            result = exponent <= 22 ? result * powersOfTen[exponent] : result * std::pow(10.0, exponent);
+        value = static_cast<float>(negative ? -result : result);
+        p = cursor;
+        return true;
+    }
+
+    ////////////////////////// OBJ
+
+    struct ObjChunk
+    {
+        const char *begin;
+        const char *end;
+
+        // Element counts of the chunk, then the offsets of its first elements in the whole file
+        size_t positionCount = 0;
+        size_t normalCount = 0;
+        size_t uvCount = 0;
+        size_t triangleCount = 0;
+        size_t positionBase = 0;
+        size_t normalBase = 0;
+        size_t uvBase = 0;
+        size_t triangleBase = 0;
+
+        bool valid = true;
+        bool normalsMatch = true; // Every face corner's normal index equals its position index
+        bool uvsMatch = true;
+    };
+
+    // Counts what one chunk declares, so every chunk knows where its elements land before parsing.
+    void countObjChunk(ObjChunk &chunk)
+    {
+        const char *p = chunk.begin;
+        const char *end = chunk.end;
+        while (p < end)
+        {
+            skipBlanks(p, end);
+            if (p + 1 < end && p[0] == 'v')
+            {
+                if (isBlank(p[1]))
+                    chunk.positionCount++;
+                else if (p[1] == 'n' && p + 2 < end && isBlank(p[2]))
+                    chunk.normalCount++;
+                else if (p[1] == 't' && p + 2 < end && isBlank(p[2]))
+                    chunk.uvCount++;
+            }
+            else if (p + 1 < end && p[0] == 'f' && isBlank(p[1]))
+            {
+                p++;
+                size_t corners = 0;
+                while (true)
+                {
+                    skipBlanks(p, end);
+                    if (atLineEnd(p, end))
+                        break;
+                    corners++;
+                    while (p < end && !isBlank(*p) && *p != '\n')
+                        p++;
+                }
+                chunk.triangleCount += corners >= 3 ? corners - 2 : 0;
+            }
+            skipLine(p, end);
+        }
+    }
+
+    // Resolves a one based or negative relative OBJ index against the number of elements declared so far.
+    bool resolveObjIndex(int64_t index, size_t declared, size_t total, uint32_t &resolved)
+    {
+        int64_t zeroBased = index > 0 ? index - 1 : static_cast<int64_t>(declared) + index;
+        if (index == 0 || zeroBased < 0 || zeroBased >= static_cast<int64_t>(total))
+            return false;
+        resolved = static_cast<uint32_t>(zeroBased);
+        return true;
+    }
+
+    void parseObjChunk(ObjChunk &chunk, MeshData &mesh, std::vector<glm::vec3> &fileNormals, std::vector<glm::vec2> &fileUVs)
+    {
+        glm::vec3 *positions = mesh.positions.data() + chunk.positionBase;
+        glm::vec3 *normals = fileNormals.data() + chunk.normalBase;
+        glm::vec2 *uvs = fileUVs.data() + chunk.uvBase;
+        uint32_t *indices = mesh.indices.data() + 3 * chunk.triangleBase;
+        size_t positionsRead = 0, normalsRead = 0, uvsRead = 0;
+
+        const char *p = chunk.begin;
+        const char *end = chunk.end;
+        while (p < end)
+        {
+            skipBlanks(p, end);
+            if (p + 1 < end && p[0] == 'v' && isBlank(p[1]))
+            {
+                p += 2;
+                glm::vec3 &position = positions[positionsRead++];
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    skipBlanks(p, end);
+                    chunk.valid &= parseFloat(p, end, position[axis]);
+                }
+            }
+            else if (p + 2 < end && p[0] == 'v' && p[1] == 'n' && isBlank(p[2]))
+            {
+                p += 3;
+                glm::vec3 &normal = normals[normalsRead++];
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    skipBlanks(p, end);
+                    chunk.valid &= parseFloat(p, end, normal[axis]);
+                }
+            }
+            else if (p + 2 < end && p[0] == 'v' && p[1] == 't' && isBlank(p[2]))
+            {
+                p += 3;
+                glm::vec2 &uv = uvs[uvsRead++];
+                skipBlanks(p, end);
+                chunk.valid &= parseFloat(p, end, uv.x);
+                skipBlanks(p, end);
+                if (!atLineEnd(p, end))
+                    chunk.valid &= parseFloat(p, end, uv.y);
+            }
+            else if (p + 1 < end && p[0] == 'f' && isBlank(p[1]))
+            {
+                p++;
+                uint32_t first = 0, previous = 0;
+                for (int corner = 0;; corner++)
+                {
+                    skipBlanks(p, end);
+                    if (atLineEnd(p, end))
+                        break;
+
+                    // v, v/vt, v//vn or v/vt/vn
+                    int64_t index;
+                    uint32_t position;
+                    if (!parseInteger(p, end, index) ||
+                        !resolveObjIndex(index, chunk.positionBase + positionsRead, mesh.positions.size(), position))
+                    {
+                        chunk.valid = false;
+                        break;
+                    }
+                    bool hasUV = false, hasNormal = false;
+                    uint32_t uv = 0, normal = 0;
+                    if (p < end && *p == '/')
+                    {
+                        p++;
+                        if (p < end && *p != '/')
+                        {
+                            hasUV = parseInteger(p, end, index) &&
+                                    resolveObjIndex(index, chunk.uvBase + uvsRead, fileUVs.size(), uv);
+                            chunk.valid &= hasUV;
+                        }
+                        if (p < end && *p == '/')
+                        {
+                            p++;
+                            hasNormal = parseInteger(p, end, index) &&
+                                        resolveObjIndex(index, chunk.normalBase + normalsRead, fileNormals.size(), normal);
+                            chunk.valid &= hasNormal;
+                        }
+                    }
+                    chunk.uvsMatch &= hasUV && uv == position;
+                    chunk.normalsMatch &= hasNormal && normal == position;
+
+                    if (corner == 0)
+                        first = position;
+                    else if (corner >= 2)
+                    {
+                        *indices++ = first;
+                        *indices++ = previous;
+                        *indices++ = position;
+                    }
+                    previous = position;
+                }
+            }
+            skipLine(p, end);
+        }
+    }
+
+    bool loadObj(const MappedFile &file, MeshData &mesh, ThreadPool *pool)
+    {
+        // Cut the file into chunks at line boundaries
+        const char *data = file.data();
+        const char *dataEnd = data + file.size();
+        size_t chunkCount = chunkCountFor(pool, file.size(), 1 << 20);
+        std::vector<ObjChunk> chunks;
+        const char *chunkStart = data;
+        for (size_t chunk = 0; chunk < chunkCount && chunkStart < dataEnd; chunk++)
+        {
+            const char *chunkEnd = chunk + 1 == chunkCount ? dataEnd : std::max(chunkStart, data + file.size() / chunkCount * (chunk + 1));
+            if (chunkEnd < dataEnd)
+                skipLine(chunkEnd, dataEnd);
+            chunks.push_back({chunkStart, chunkEnd});
+            chunkStart = chunkEnd;
+        }
+
+        forEachChunk(pool, chunks.size(), [&](size_t chunk)
+        {
+            countObjChunk(chunks[chunk]);
+        });
+
+        size_t positionCount = 0, normalCount = 0, uvCount = 0, triangleCount = 0;
+        for (auto &chunk : chunks)
+        {
+            chunk.positionBase = positionCount;
+            chunk.normalBase = normalCount;
+            chunk.uvBase = uvCount;
+            chunk.triangleBase = triangleCount;
+            positionCount += chunk.positionCount;
+            normalCount += chunk.normalCount;
+            uvCount += chunk.uvCount;
+            triangleCount += chunk.triangleCount;
+        }
+        if (positionCount > UINT32_MAX || triangleCount > UINT32_MAX / 3)
+        {
+            std::cerr << "Mesh loader: too many vertices or triangles for 32-bit indices" << std::endl;
+            return false;
+        }
+
+        mesh.positions.resize(positionCount);
+        mesh.indices.resize(3 * triangleCount);
+        std::vector<glm::vec3> fileNormals(normalCount);
+        std::vector<glm::vec2> fileUVs(uvCount);
+        forEachChunk(pool, chunks.size(), [&](size_t chunk)
+        {
+            parseObjChunk(chunks[chunk], mesh, fileNormals, fileUVs);
+        });
+
+        bool normalsMatch = normalCount == positionCount;
+        bool uvsMatch = uvCount == positionCount;
+        for (const auto &chunk : chunks)
+        {
+            if (!chunk.valid)
+            {
+                std::cerr << "Mesh loader: malformed OBJ data near byte " << chunk.begin - data << std::endl;
+                return false;
+            }
+            normalsMatch &= chunk.normalsMatch;
+            uvsMatch &= chunk.uvsMatch;
+        }
+
+        // Attributes indexed separately from positions would need vertices split, they are dropped instead
+        if (normalsMatch)
+            mesh.normals = std::move(fileNormals);
+        if (uvsMatch)
+            mesh.uvs = std::move(fileUVs);
+        return true;
+    }
+
+    ////////////////////////// Binary PLY
+
+    enum class PlyType
+    {
+        Int8,
+        UInt8,
+        Int16,
+        UInt16,
+        Int32,
+        UInt32,
+        Float32,
+        Float64,
+        Invalid
+    };
+
+    PlyType parsePlyType(std::string_view name)
+    {
+        if (name == "char" || name == "int8")
+            return PlyType::Int8;
+        if (name == "uchar" || name == "uint8")
+            return PlyType::UInt8;
+        if (name == "short" || name == "int16")
+            return PlyType::Int16;
+        if (name == "ushort" || name == "uint16")
+            return PlyType::UInt16;
+        if (name == "int" || name == "int32")
+            return PlyType::Int32;
+        if (name == "uint" || name == "uint32")
+            return PlyType::UInt32;
+        if (name == "float" || name == "float32")
+            return PlyType::Float32;
+        if (name == "double" || name == "float64")
+            return PlyType::Float64;
+        return PlyType::Invalid;
+    }
+
+    size_t plyTypeSize(PlyType type)
+    {
+        switch (type)
+        {
+        case PlyType::Int8:
+        case PlyType::UInt8:
+            return 1;
+        case PlyType::Int16:
+        case PlyType::UInt16:
+            return 2;
+        case PlyType::Int32:
+        case PlyType::UInt32:
+        case PlyType::Float32:
+            return 4;
+        case PlyType::Float64:
+            return 8;
+        default:
+            return 0;
+        }
+    }
+
+    template <typename T>
+    T readPly(const char *p, bool swapBytes)
+    {
+        unsigned char bytes[sizeof(T)];
+        std::memcpy(bytes, p, sizeof(T));
+        if (swapBytes)
+            std::reverse(bytes, bytes + sizeof(T));
+        T value;
+        std::memcpy(&value, bytes, sizeof(T));
+        return value;
+    }
+
+    double readPlyValue(const char *p, PlyType type, bool swapBytes)
+    {
+        switch (type)
+        {
+        case PlyType::Int8:
+            return readPly<int8_t>(p, swapBytes);
+        case PlyType::UInt8:
+            return readPly<uint8_t>(p, swapBytes);
+        case PlyType::Int16:
+            return readPly<int16_t>(p, swapBytes);
+        case PlyType::UInt16:
+            return readPly<uint16_t>(p, swapBytes);
+        case PlyType::Int32:
+            return readPly<int32_t>(p, swapBytes);
+        case PlyType::UInt32:
+            return readPly<uint32_t>(p, swapBytes);
+        case PlyType::Float32:
+            return readPly<float>(p, swapBytes);
+        case PlyType::Float64:
+            return readPly<double>(p, swapBytes);
+        default:
+            return 0.0;
+        }
+    }
+
+    struct PlyProperty
+    {
+        std::string_view name;
+        PlyType type = PlyType::Invalid; // Item type for lists
+        PlyType countType = PlyType::Invalid;
+        bool isList = false;
+        size_t offset = 0; // Byte offset within a record of an element without lists
+    };
+
+    struct PlyElement
+    {
+        std::string_view name;
+        size_t count = 0;
+        std::vector<PlyProperty> properties;
+        size_t stride = 0; // Record size when no property is a list
+        bool hasLists = false;
+
+        const PlyProperty *find(std::string_view propertyName) const
+        {
+            for (const auto &property : properties)
+            {
+                if (property.name == propertyName)
+                    return &property;
+            }
+            return nullptr;
+        }
+    };
+
+    // Splits the next whitespace separated word off line.
+    std::string_view nextWord(std::string_view &line)
+    {
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == std::string_view::npos)
+        {
+            line = {};
+            return {};
+        }
+        size_t stop = line.find_first_of(" \t\r", start);
+        std::string_view word = line.substr(start, stop == std::string_view::npos ? std::string_view::npos : stop - start);
+        line = stop == std::string_view::npos ? std::string_view() : line.substr(stop);
+        return word;
+    }
+
+    // Whether count records of recordSize bytes fit between p and end, checked without overflowing count * recordSize.
+    bool plyRecordsFit(size_t count, size_t recordSize, const char *p, const char *end)
+    {
+        return recordSize == 0 || count <= static_cast<size_t>(end - p) / recordSize;
+    }
+
+    // Size of one record of an element with lists, or 0 when it runs past the end of the file.
+    size_t plyRecordSize(const PlyElement &element, const char *p, const char *end, bool swapBytes)
+    {
+        size_t size = 0;
+        for (const auto &property : element.properties)
+        {
+            if (!property.isList)
+            {
+                size += plyTypeSize(property.type);
+                continue;
+            }
+            size_t countSize = plyTypeSize(property.countType);
+            if (p + size + countSize > end)
+                return 0;
+            auto items = static_cast<size_t>(readPlyValue(p + size, property.countType, swapBytes));
+            size += countSize + items * plyTypeSize(property.type);
+        }
+        return p + size <= end ? size : 0;
+    }
+
+    bool loadPlyVertices(const PlyElement &element, const char *p, bool swapBytes, MeshData &mesh, ThreadPool *pool)
+    {
+        const PlyProperty *position[3] = {element.find("x"), element.find("y"), element.find("z")};
+        const PlyProperty *normal[3] = {element.find("nx"), element.find("ny"), element.find("nz")};
+        const PlyProperty *uv[2] = {element.find("u"), element.find("v")};
+        if (!uv[0] || !uv[1])
+        {
+            uv[0] = element.find("s");
+            uv[1] = element.find("t");
+        }
+        if (!uv[0] || !uv[1])
+        {
+            uv[0] = element.find("texture_u");
+            uv[1] = element.find("texture_v");
+        }
+        if (!position[0] || !position[1] || !position[2])
+        {
+            std::cerr << "Mesh loader: PLY vertices have no x, y, z properties" << std::endl;
+            return false;
+        }
+        bool hasNormals = normal[0] && normal[1] && normal[2];
+        bool hasUVs = uv[0] && uv[1];
+
+        mesh.positions.resize(element.count);
+        if (hasNormals)
+            mesh.normals.resize(element.count);
+        if (hasUVs)
+            mesh.uvs.resize(element.count);
+
+        size_t chunkCount = chunkCountFor(pool, element.count, 1 << 16);
+        size_t chunkSize = (element.count + chunkCount - 1) / chunkCount;
+        forEachChunk(pool, chunkCount, [&](size_t chunk)
+        {
+            size_t begin = std::min(element.count, chunk * chunkSize);
+            size_t end = std::min(element.count, begin + chunkSize);
+            for (size_t vertex = begin; vertex < end; vertex++)
+            {
+                const char *record = p + vertex * element.stride;
+                for (int axis = 0; axis < 3; axis++)
+                    mesh.positions[vertex][axis] = static_cast<float>(readPlyValue(record + position[axis]->offset, position[axis]->type, swapBytes));
+                if (hasNormals)
+                {
+                    for (int axis = 0; axis < 3; axis++)
+                        mesh.normals[vertex][axis] = static_cast<float>(readPlyValue(record + normal[axis]->offset, normal[axis]->type, swapBytes));
+                }
+                if (hasUVs)
+                {
+                    mesh.uvs[vertex].x = static_cast<float>(readPlyValue(record + uv[0]->offset, uv[0]->type, swapBytes));
+                    mesh.uvs[vertex].y = static_cast<float>(readPlyValue(record + uv[1]->offset, uv[1]->type, swapBytes));
+                }
+            }
+        });
+        return true;
+    }
+
+    // Reads the faces starting at p and returns the number of bytes they occupy, or 0 on malformed data.
+    size_t loadPlyFaces(const PlyElement &element, const char *p, const char *end, bool swapBytes, MeshData &mesh, ThreadPool *pool)
+    {
+        const PlyProperty *list = element.find("vertex_indices");
+        if (!list)
+            list = element.find("vertex_index");
+        if (!list || !list->isList)
+        {
+            std::cerr << "Mesh loader: PLY faces have no vertex_indices list" << std::endl;
+            return 0;
+        }
+        size_t countSize = plyTypeSize(list->countType);
+        size_t indexSize = plyTypeSize(list->type);
+
+        // Fast path when every face is a triangle: records have a fixed size and are decoded in parallel
+        size_t fixedSize = 0, listOffset = 0;
+        bool otherLists = false;
+        for (const auto &property : element.properties)
+        {
+            if (&property == list)
+            {
+                listOffset = fixedSize;
+                fixedSize += countSize + 3 * indexSize;
+            }
+            else if (property.isList)
+                otherLists = true;
+            else
+                fixedSize += plyTypeSize(property.type);
+        }
+
+        size_t chunkCount = chunkCountFor(pool, element.count, 1 << 16);
+        size_t chunkSize = (element.count + chunkCount - 1) / chunkCount;
+        size_t vertexCount = mesh.positions.size();
+        bool allTriangles = !otherLists && plyRecordsFit(element.count, fixedSize, p, end);
+        if (allTriangles)
+        {
+            std::atomic<bool> triangles{true};
+            forEachChunk(pool, chunkCount, [&](size_t chunk)
+            {
+                size_t begin = std::min(element.count, chunk * chunkSize);
+                size_t stop = std::min(element.count, begin + chunkSize);
+                for (size_t face = begin; face < stop && triangles.load(std::memory_order_relaxed); face++)
+                {
+                    if (readPlyValue(p + face * fixedSize + listOffset, list->countType, swapBytes) != 3.0)
+                        triangles = false;
+                }
+            });
+            allTriangles = triangles;
+        }
+
+        std::atomic<bool> valid{true};
+        if (allTriangles)
+        {
+            mesh.indices.resize(3 * element.count);
+            forEachChunk(pool, chunkCount, [&](size_t chunk)
+            {
+                size_t begin = std::min(element.count, chunk * chunkSize);
+                size_t stop = std::min(element.count, begin + chunkSize);
+                for (size_t face = begin; face < stop; face++)
+                {
+                    const char *items = p + face * fixedSize + listOffset + countSize;
+                    for (int corner = 0; corner < 3; corner++)
+                    {
+                        double index = readPlyValue(items + corner * indexSize, list->type, swapBytes);
+                        if (index < 0 || index >= vertexCount)
+                            valid = false;
+                        mesh.indices[3 * face + corner] = static_cast<uint32_t>(index);
+                    }
+                }
+            });
+            return valid ? element.count * fixedSize : 0;
+        }
+
+        // Polygons or extra lists: walk the records one by one and fan triangulate
+        const char *record = p;
+        for (size_t face = 0; face < element.count; face++)
+        {
+            size_t recordSize = plyRecordSize(element, record, end, swapBytes);
+            if (recordSize == 0)
+                return 0;
+            size_t offset = 0;
+            for (const auto &property : element.properties)
+            {
+                if (!property.isList)
+                {
+                    offset += plyTypeSize(property.type);
+                    continue;
+                }
+                auto items = static_cast<size_t>(readPlyValue(record + offset, property.countType, swapBytes));
+                offset += plyTypeSize(property.countType);
+                if (&property == list)
+                {
+                    for (size_t corner = 2; corner < items; corner++)
+                    {
+                        for (size_t item : {size_t(0), corner - 1, corner})
+                        {
+                            double index = readPlyValue(record + offset + item * indexSize, list->type, swapBytes);
+                            if (index < 0 || index >= vertexCount)
+                                return 0;
+                            mesh.indices.push_back(static_cast<uint32_t>(index));
+                        }
+                    }
+                }
+                offset += items * plyTypeSize(property.type);
+            }
+            record += recordSize;
+        }
+        return record - p;
+    }
+
+    bool loadPly(const MappedFile &file, MeshData &mesh, ThreadPool *pool)
+    {
+        const char *data = file.data();
+        const char *end = data + file.size();
+        std::string_view text(data, file.size());
+        size_t headerEnd = text.find("end_header");
+        if (headerEnd == std::string_view::npos)
+        {
+            std::cerr << "Mesh loader: PLY header has no end_header" << std::endl;
+            return false;
+        }
+        const char *body = data + headerEnd;
+        skipLine(body, end);
+
+        bool littleEndian = true;
+        std::vector<PlyElement> elements;
+        std::string_view header = text.substr(0, headerEnd);
+        while (!header.empty())
+        {
+            size_t lineEnd = header.find('\n');
+            std::string_view line = header.substr(0, lineEnd);
+            header = lineEnd == std::string_view::npos ? std::string_view() : header.substr(lineEnd + 1);
+
+            std::string_view keyword = nextWord(line);
+            if (keyword == "format")
+            {
+                std::string_view format = nextWord(line);
+                if (format == "ascii")
+                {
+                    std::cerr << "Mesh loader: ASCII PLY is not supported, convert it to binary" << std::endl;
+                    return false;
+                }
+                littleEndian = format == "binary_little_endian";
+            }
+            else if (keyword == "element")
+            {
+                PlyElement element;
+                element.name = nextWord(line);
+                std::string_view count = nextWord(line);
+                const char *countText = count.data();
+                int64_t countValue = 0;
+                if (!parseInteger(countText, count.data() + count.size(), countValue) || countValue < 0)
+                {
+                    std::cerr << "Mesh loader: bad PLY element count" << std::endl;
+                    return false;
+                }
+                element.count = static_cast<size_t>(countValue);
+                elements.push_back(element);
+            }
+            else if (keyword == "property" && !elements.empty())
+            {
+                PlyElement &element = elements.back();
+                PlyProperty property;
+                std::string_view type = nextWord(line);
+                if (type == "list")
+                {
+                    property.isList = true;
+                    property.countType = parsePlyType(nextWord(line));
+                    type = nextWord(line);
+                    element.hasLists = true;
+                }
+                property.type = parsePlyType(type);
+                property.name = nextWord(line);
+                if (property.type == PlyType::Invalid || (property.isList && property.countType == PlyType::Invalid))
+                {
+                    std::cerr << "Mesh loader: unknown PLY property type" << std::endl;
+                    return false;
+                }
+                property.offset = element.stride;
+                if (!property.isList)
+                    element.stride += plyTypeSize(property.type);
+                element.properties.push_back(property);
+            }
+        }
+
+        bool swapBytes = littleEndian != (std::endian::native == std::endian::little);
+        const char *p = body;
+        for (const auto &element : elements)
+        {
+            if (element.name == "vertex")
+            {
+                if (element.hasLists || !plyRecordsFit(element.count, element.stride, p, end))
+                {
+                    std::cerr << "Mesh loader: PLY vertex data is truncated or has lists" << std::endl;
+                    return false;
+                }
+                if (element.count > UINT32_MAX || !loadPlyVertices(element, p, swapBytes, mesh, pool))
+                    return false;
+                p += element.count * element.stride;
+            }
+            else if (element.name == "face")
+            {
+                if (mesh.positions.empty())
+                {
+                    std::cerr << "Mesh loader: PLY faces must follow the vertices" << std::endl;
+                    return false;
+                }
+                size_t size = loadPlyFaces(element, p, end, swapBytes, mesh, pool);
+                if (size == 0 && element.count > 0)
+                {
+                    std::cerr << "Mesh loader: PLY face data is truncated or indexes missing vertices" << std::endl;
+                    return false;
+                }
+                p += size;
+            }
+            else if (!element.hasLists)
+            {
+                if (!plyRecordsFit(element.count, element.stride, p, end))
+                {
+                    std::cerr << "Mesh loader: PLY data is truncated" << std::endl;
+                    return false;
+                }
+                p += element.count * element.stride;
+            }
+            else
+            {
+                for (size_t record = 0; record < element.count; record++)
+                {
+                    size_t size = plyRecordSize(element, p, end, swapBytes);
+                    if (size == 0)
+                        return false;
+                    p += size;
+                }
+            }
+            if (p > end)
+            {
+                std::cerr << "Mesh loader: PLY data is truncated" << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+bool loadMesh(const std::string &path, MeshData &mesh, MeshLoadStats &stats, ThreadPool *pool)
+{
+    LUMI_PROFILE_SCOPE("mesh load");
+    auto start = std::chrono::high_resolution_clock::now();
+    MappedFile file(path);
+    if (!file.isOpen())
+    {
+        std::cerr << "Mesh loader: cannot open " << path << std::endl;
+        return false;
+    }
+
+    mesh = MeshData();
+    std::string_view magic(file.data(), std::min<size_t>(file.size(), 3));
+    bool loaded = magic == "ply" ? loadPly(file, mesh, pool) : loadObj(file, mesh, pool);
+    if (loaded && mesh.indices.empty())
+    {
+        std::cerr << "Mesh loader: " << path << " has no triangles" << std::endl;
+        loaded = false;
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    stats.bytes = file.size();
+    stats.seconds = std::chrono::duration<double>(end - start).count();
+    return loaded;
+}
+
+std::shared_ptr<TriangleMesh> loadTriangleMesh(const std::string &path, MaterialTable &materials, uint32_t material,
+                                               ThreadPool *pool)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    BVHBuildOptions options = TriangleMesh::defaultBVHOptions();
+    options.pool = pool;
+
+    SceneCacheKey key;
+    key.addFile(path);
+    key.addBuildOptions(options);
+    if (materials.get(material))
+        key.addMaterial(materials[material]);
+    std::string cachePath = path + ".lumicache";
+
+    std::vector<std::shared_ptr<TriangleMesh>> cached;
+    SceneCacheInfo cacheInfo;
+    if (readSceneCache(cachePath, key.value(), cached, materials, cacheInfo) && cached.size() == 1)
+    {
+        double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        std::cerr << "Loaded " << cachePath << ": " << cached[0]->triangleCount() << " triangles in " << seconds
+                  << " seconds, saving " << cacheInfo.sourceSeconds - seconds << " seconds over loading and building" << std::endl;
+        return cached[0];
+    }
+
+    MeshData data;
+    MeshLoadStats stats;
+    if (!loadMesh(path, data, stats, pool))
+        return nullptr;
+    std::cerr << "Loaded " << path << ": " << data.positions.size() << " vertices, " << data.indices.size() / 3 << " triangles, "
+              << stats.bytes / (1024.0 * 1024.0) << " MB in " << stats.seconds << " seconds (" << stats.megabytesPerSecond() << " MB/s)" << std::endl;
+
+    auto mesh = std::make_shared<TriangleMesh>(std::move(data.positions), std::move(data.indices), material,
+                                               std::move(data.normals), std::move(data.uvs), options);
+    std::cerr << "Mesh BVH build time: " << mesh->buildStats().buildSeconds << " seconds, "
+              << "Memory: " << mesh->memoryBytes() / (1024.0 * 1024.0) << " MB" << std::endl;
+
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    if (!writeSceneCache(cachePath, key.value(), {mesh}, materials, seconds))
+        std::cerr << "Could not write scene cache " << cachePath << std::endl;
+    return mesh;
+}
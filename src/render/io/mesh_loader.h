@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "geometry/objects/triangle_mesh.h"
+#include "material/material_table.h"
+
+class ThreadPool;
+
+// Geometry read from a mesh file, laid out as the arrays TriangleMesh takes over without copying.
+struct MeshData
+{
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices; // Three per triangle, polygons are fan triangulated
+    std::vector<glm::vec3> normals; // Per vertex, empty when the file has none or they are not indexed like positions
+    std::vector<glm::vec2> uvs;     // Per vertex, same rules as normals
+};
+
+// Size and duration of a mesh load.
+struct MeshLoadStats
+{
+    size_t bytes = 0;
+    double seconds = 0.0;
+
+    double megabytesPerSecond() const { return seconds > 0.0 ? bytes / (1024.0 * 1024.0) / seconds : 0.0; }
+};
+
+// Loads a Wavefront OBJ or binary PLY file, told apart by the PLY magic number. The file is memory mapped
+// and parsed in chunks on pool when one is given. Prints the reason and returns false on malformed input.
+bool loadMesh(const std::string &path, MeshData &mesh, MeshLoadStats &stats, ThreadPool *pool = nullptr);
+
+// Loads a mesh file into a TriangleMesh with the given entry of materials, building its BVH on pool as well, and
+// prints load throughput and build time. The result is cached next to the file as FILE.lumicache and mapped
+// directly on later loads while the file, material and BVH settings stay the same; the mesh then uses the
+// cache's copy of the material. Returns nullptr when the file cannot be loaded.
+std::shared_ptr<TriangleMesh> loadTriangleMesh(const std::string &path, MaterialTable &materials, uint32_t material,
+                                               ThreadPool *pool = nullptr);
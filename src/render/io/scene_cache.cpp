@@ -0,0 +1,311 @@
+#include "scene_cache.h"
+#include "mapped_file.h"
+#include "stats/profiler.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+
+namespace
+{
+    // Bump whenever the layout of the file or of any stored struct changes.
+    constexpr uint32_t cacheVersion = 1;
+    constexpr char cacheMagic[8] = {'L', 'U', 'M', 'I', 'S', 'C', 'N', 'E'};
+    constexpr uint32_t endianTag = 0x01020304;
+    constexpr uint64_t sectionAlignment = 64;
+
+    // File layout: header, material records, mesh entries, then each mesh's arrays. All offsets are from the
+    // start of the file and sections are 64 byte aligned, so a mapping can be used in place.
+    struct CacheHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t endian;
+        uint64_t key;
+        uint64_t fileSize;
+        uint64_t materialOffset;
+        uint64_t meshOffset;
+        uint32_t materialCount;
+        uint32_t meshCount;
+        double sourceSeconds;
+    };
+
+    struct CacheMesh
+    {
+        uint64_t positionsOffset;
+        uint64_t indicesOffset;
+        uint64_t normalsOffset; // 0 when absent
+        uint64_t uvsOffset;     // 0 when absent
+        uint64_t nodesOffset;
+        uint64_t vertexCount;
+        uint64_t triangleCount;
+        uint64_t nodeCount;
+        uint32_t material; // Index into the material records
+        uint32_t pad;
+    };
+
+    static_assert(std::is_trivially_copyable_v<LinearBVHNode> && sizeof(LinearBVHNode) == 32);
+    static_assert(std::is_trivially_copyable_v<MaterialRecord> && sizeof(MaterialRecord) == 16);
+    static_assert(sizeof(glm::vec3) == 12 && sizeof(glm::vec2) == 8, "vertex arrays are stored as packed floats");
+
+    uint64_t alignUp(uint64_t offset) { return (offset + sectionAlignment - 1) / sectionAlignment * sectionAlignment; }
+
+    // Whether count items of itemSize at offset lie within the file.
+    bool sectionFits(uint64_t offset, uint64_t count, uint64_t itemSize, uint64_t fileSize)
+    {
+        return offset <= fileSize && count <= (fileSize - offset) / itemSize;
+    }
+
+    // Whether a mesh's indices and BVH can be used without reading out of bounds: every index names a
+    // vertex, interior nodes point forward to children that exist and have no other parent, leaves cover
+    // existing triangles, and no leaf lies deeper than the traversal stack allows.
+    bool meshContentsValid(const TriangleMesh::Arrays &arrays)
+    {
+        for (size_t i = 0; i < arrays.triangleCount * 3; i++)
+        {
+            if (arrays.indices[i] >= arrays.vertexCount)
+                return false;
+        }
+        if (arrays.nodeCount == 0)
+            return arrays.triangleCount == 0;
+
+        // Parents come before their children, so a forward sweep knows each node's depth before reaching it
+        std::vector<int> depths(arrays.nodeCount, -1);
+        depths[0] = 0;
+        for (size_t i = 0; i < arrays.nodeCount; i++)
+        {
+            const LinearBVHNode &node = arrays.nodes[i];
+            if (depths[i] < 0)
+                continue; // Unreachable from the root, never visited
+            if (node.isLeaf())
+            {
+                if (node.offset > arrays.triangleCount || node.primitiveCount > arrays.triangleCount - node.offset)
+                    return false;
+                continue;
+            }
+            if (node.offset <= i + 1 || node.offset >= arrays.nodeCount || depths[i] + 1 > LinearBVH::maxStackDepth)
+                return false;
+            for (size_t child : {i + 1, static_cast<size_t>(node.offset)})
+            {
+                if (depths[child] >= 0)
+                    return false;
+                depths[child] = depths[i] + 1;
+            }
+        }
+        return true;
+    }
+}
+
+void SceneCacheKey::add(const void *data, size_t size)
+{
+    const auto *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+}
+
+void SceneCacheKey::add(std::string_view text)
+{
+    uint64_t length = text.size();
+    add(&length, sizeof(length));
+    add(text.data(), text.size());
+}
+
+void SceneCacheKey::addFile(const std::string &path)
+{
+    add(path);
+    std::error_code error;
+    uint64_t size = std::filesystem::file_size(path, error);
+    add(&size, sizeof(size));
+    auto modified = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+    add(&modified, sizeof(modified));
+}
+
+void SceneCacheKey::addBuildOptions(const BVHBuildOptions &options)
+{
+    int32_t values[] = {static_cast<int32_t>(options.splitMethod), options.maxLeafSize, options.sahBinCount, options.width, options.mortonBits};
+    add(values, sizeof(values));
+    add(&options.traversalCost, sizeof(options.traversalCost));
+}
+
+void SceneCacheKey::addMaterial(const Material &material)
+{
+    MaterialRecord record = material.record();
+    add(&record, sizeof(record));
+}
+
+bool writeSceneCache(const std::string &path, uint64_t key, const std::vector<std::shared_ptr<TriangleMesh>> &meshes,
+                     const MaterialTable &materials, double sourceSeconds)
+{
+    LUMI_PROFILE_SCOPE("scene cache write");
+    // Materials shared between meshes are stored once
+    std::vector<uint32_t> stored;
+    std::vector<MaterialRecord> records;
+    std::vector<CacheMesh> entries(meshes.size());
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        uint32_t material = meshes[i]->material();
+        size_t index = 0;
+        while (index < stored.size() && stored[index] != material)
+            index++;
+        if (index == stored.size())
+        {
+            stored.push_back(material);
+            // A material that cannot be recreated would make the cache unreadable, so don't write one
+            const Material *resolved = materials.get(material).get();
+            if (!resolved || resolved->record().type == MaterialRecord::Type::None)
+                return false;
+            records.push_back(resolved->record());
+        }
+        entries[i] = CacheMesh();
+        entries[i].material = static_cast<uint32_t>(index);
+    }
+
+    CacheHeader header = {};
+    std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+    header.version = cacheVersion;
+    header.endian = endianTag;
+    header.key = key;
+    header.sourceSeconds = sourceSeconds;
+    header.materialCount = static_cast<uint32_t>(records.size());
+    header.meshCount = static_cast<uint32_t>(meshes.size());
+    header.materialOffset = alignUp(sizeof(CacheHeader));
+    header.meshOffset = alignUp(header.materialOffset + records.size() * sizeof(MaterialRecord));
+
+    // Lay out every mesh's arrays
+    uint64_t offset = alignUp(header.meshOffset + entries.size() * sizeof(CacheMesh));
+    auto place = [&](uint64_t bytes)
+    {
+        uint64_t start = offset;
+        offset = alignUp(offset + bytes);
+        return start;
+    };
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        const TriangleMesh::Arrays &arrays = meshes[i]->arrays();
+        CacheMesh &entry = entries[i];
+        entry.vertexCount = arrays.vertexCount;
+        entry.triangleCount = arrays.triangleCount;
+        entry.nodeCount = arrays.nodeCount;
+        entry.positionsOffset = place(arrays.vertexCount * sizeof(glm::vec3));
+        entry.indicesOffset = place(arrays.triangleCount * 3 * sizeof(uint32_t));
+        entry.normalsOffset = arrays.normals ? place(arrays.vertexCount * sizeof(glm::vec3)) : 0;
+        entry.uvsOffset = arrays.uvs ? place(arrays.vertexCount * sizeof(glm::vec2)) : 0;
+        entry.nodesOffset = place(arrays.nodeCount * sizeof(LinearBVHNode));
+    }
+    header.fileSize = offset;
+
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file)
+            return false;
+
+        uint64_t written = 0;
+        auto writeAt = [&](uint64_t position, const void *data, uint64_t bytes)
+        {
+            static const char zeros[sectionAlignment] = {};
+            while (written < position)
+            {
+                uint64_t padding = std::min<uint64_t>(position - written, sectionAlignment);
+                file.write(zeros, static_cast<std::streamsize>(padding));
+                written += padding;
+            }
+            file.write(static_cast<const char *>(data), static_cast<std::streamsize>(bytes));
+            written += bytes;
+        };
+
+        writeAt(0, &header, sizeof(header));
+        writeAt(header.materialOffset, records.data(), records.size() * sizeof(MaterialRecord));
+        writeAt(header.meshOffset, entries.data(), entries.size() * sizeof(CacheMesh));
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            const TriangleMesh::Arrays &arrays = meshes[i]->arrays();
+            const CacheMesh &entry = entries[i];
+            writeAt(entry.positionsOffset, arrays.positions, entry.vertexCount * sizeof(glm::vec3));
+            writeAt(entry.indicesOffset, arrays.indices, entry.triangleCount * 3 * sizeof(uint32_t));
+            if (arrays.normals)
+                writeAt(entry.normalsOffset, arrays.normals, entry.vertexCount * sizeof(glm::vec3));
+            if (arrays.uvs)
+                writeAt(entry.uvsOffset, arrays.uvs, entry.vertexCount * sizeof(glm::vec2));
+            writeAt(entry.nodesOffset, arrays.nodes, entry.nodeCount * sizeof(LinearBVHNode));
+        }
+        writeAt(header.fileSize, nullptr, 0);
+        if (!file)
+            return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    return !error;
+}
+
+bool readSceneCache(const std::string &path, uint64_t key, std::vector<std::shared_ptr<TriangleMesh>> &meshes,
+                    MaterialTable &materials, SceneCacheInfo &info)
+{
+    LUMI_PROFILE_SCOPE("scene cache read");
+    auto file = std::make_shared<const MappedFile>(path);
+    if (!file->isOpen() || file->size() < sizeof(CacheHeader))
+        return false;
+
+    // The header is the only thing read, everything else is used where it lies in the mapping
+    const char *base = file->data();
+    const auto *header = reinterpret_cast<const CacheHeader *>(base);
+    if (std::memcmp(header->magic, cacheMagic, sizeof(cacheMagic)) != 0 || header->version != cacheVersion ||
+        header->endian != endianTag || header->key != key || header->fileSize != file->size())
+        return false;
+
+    uint64_t fileSize = file->size();
+    if (!sectionFits(header->materialOffset, header->materialCount, sizeof(MaterialRecord), fileSize) ||
+        !sectionFits(header->meshOffset, header->meshCount, sizeof(CacheMesh), fileSize))
+        return false;
+
+    // Cached materials go to the table only once the whole file checked out
+    const auto *records = reinterpret_cast<const MaterialRecord *>(base + header->materialOffset);
+    std::vector<std::shared_ptr<Material>> cachedMaterials;
+    for (uint32_t i = 0; i < header->materialCount; i++)
+    {
+        cachedMaterials.push_back(Material::fromRecord(records[i]));
+        if (!cachedMaterials.back())
+            return false;
+    }
+    uint32_t firstMaterial = static_cast<uint32_t>(materials.size());
+
+    const auto *entries = reinterpret_cast<const CacheMesh *>(base + header->meshOffset);
+    std::vector<std::shared_ptr<TriangleMesh>> loaded;
+    for (uint32_t i = 0; i < header->meshCount; i++)
+    {
+        const CacheMesh &entry = entries[i];
+        bool fits = entry.material < header->materialCount &&
+                    sectionFits(entry.positionsOffset, entry.vertexCount, sizeof(glm::vec3), fileSize) &&
+                    sectionFits(entry.indicesOffset, entry.triangleCount, 3 * sizeof(uint32_t), fileSize) &&
+                    sectionFits(entry.nodesOffset, entry.nodeCount, sizeof(LinearBVHNode), fileSize) &&
+                    (entry.normalsOffset == 0 || sectionFits(entry.normalsOffset, entry.vertexCount, sizeof(glm::vec3), fileSize)) &&
+                    (entry.uvsOffset == 0 || sectionFits(entry.uvsOffset, entry.vertexCount, sizeof(glm::vec2), fileSize));
+        if (!fits)
+            return false;
+
+        TriangleMesh::Arrays arrays;
+        arrays.positions = reinterpret_cast<const glm::vec3 *>(base + entry.positionsOffset);
+        arrays.indices = reinterpret_cast<const uint32_t *>(base + entry.indicesOffset);
+        arrays.normals = entry.normalsOffset ? reinterpret_cast<const glm::vec3 *>(base + entry.normalsOffset) : nullptr;
+        arrays.uvs = entry.uvsOffset ? reinterpret_cast<const glm::vec2 *>(base + entry.uvsOffset) : nullptr;
+        arrays.nodes = reinterpret_cast<const LinearBVHNode *>(base + entry.nodesOffset);
+        arrays.vertexCount = entry.vertexCount;
+        arrays.triangleCount = entry.triangleCount;
+        arrays.nodeCount = entry.nodeCount;
+        if (!meshContentsValid(arrays))
+            return false;
+        loaded.push_back(std::make_shared<TriangleMesh>(arrays, file, firstMaterial + entry.material));
+    }
+
+    for (auto &material : cachedMaterials)
+        materials.add(std::move(material));
+
+    meshes = std::move(loaded);
+    info.bytes = file->size();
+    info.sourceSeconds = header->sourceSeconds;
+    return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "geometry/objects/triangle_mesh.h"
+#include "geometry/bounding/linear_bvh.h"
+#include "material/material_table.h"
+
+// Incremental FNV-1a hash of everything a cached scene was built from, scene inputs and builder settings.
+// A cache written under a different key is stale and gets rebuilt.
+class SceneCacheKey
+{
+public:
+    void add(const void *data, size_t size);
+    void add(std::string_view text);
+
+    // Identity of a source file: its path, size and modification time, without reading it.
+    void addFile(const std::string &path);
+
+    // Settings that change the built hierarchy, the thread pool does not.
+    void addBuildOptions(const BVHBuildOptions &options);
+
+    void addMaterial(const Material &material);
+
+    uint64_t value() const { return hash; }
+
+private:
+    uint64_t hash = 14695981039346656037ull;
+};
+
+// Summary of a cache file.
+struct SceneCacheInfo
+{
+    size_t bytes = 0;
+    double sourceSeconds = 0.0; // Time loading and building took when the cache was written
+};
+
+// Writes meshes with their materials, looked up in materials, and built BVHs to path in a pointer-free layout,
+// replacing any existing file only once the new one is complete. Returns false when the file cannot be written
+// or a mesh's material has no record to recreate it from.
+bool writeSceneCache(const std::string &path, uint64_t key, const std::vector<std::shared_ptr<TriangleMesh>> &meshes,
+                     const MaterialTable &materials, double sourceSeconds);
+
+// Maps a cache file and returns meshes that intersect straight from the mapping, with no parsing or copying.
+// The cached materials are added to materials. Returns false when the file is missing, truncated, of another
+// format version or written under another key, or when its contents are inconsistent: indices or BVH nodes out
+// of range, a BVH deeper than the traversal stack, or an unknown material type. Leaves materials unchanged then.
+bool readSceneCache(const std::string &path, uint64_t key, std::vector<std::shared_ptr<TriangleMesh>> &meshes,
+                    MaterialTable &materials, SceneCacheInfo &info);
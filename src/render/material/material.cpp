@@ -6,13 +6,41 @@ glm::vec3 Material::emitted(const HitRecord &rec) const
     return glm::vec3(0, 0, 0);
 }
 
+namespace
+{
+    MaterialRecord makeRecord(MaterialRecord::Type type, const glm::vec3 &color)
+    {
+        MaterialRecord record;
+        record.type = type;
+        for (int channel = 0; channel < 3; channel++)
+            record.color[channel] = color[channel];
+        return record;
+    }
+}
+
+std::shared_ptr<Material> Material::fromRecord(const MaterialRecord &record)
+{
+    glm::vec3 color(record.color[0], record.color[1], record.color[2]);
+    switch (record.type)
+    {
+    case MaterialRecord::Type::Lambertian:
+        return std::make_shared<Lambertian>(color);
+    case MaterialRecord::Type::Metal:
+        return std::make_shared<Metal>(color);
+    case MaterialRecord::Type::DiffuseLight:
+        return std::make_shared<DiffuseLight>(color);
+    default:
+        return nullptr;
+    }
+}
+
 Lambertian::Lambertian(const glm::vec3 &albedo) : albedo(albedo) {}
 
 bool Lambertian::scatter(
-    const Ray &r_in, const HitRecord &rec, glm::vec3 &attenuation, Ray &scattered, float &pdf) const
+    const Ray &r_in, const HitRecord &rec, glm::vec3 &attenuation, Ray &scattered, float &pdf, Utils::Random::RNG &rng) const
 {
     ONB uvw(rec.normal);
-    auto scatter_direction = uvw.transform(Utils::Random::randomCosineDirection());
+    auto scatter_direction = uvw.transform(Utils::Random::randomCosineDirection(rng));
     scattered = Ray(rec.point, glm::normalize(scatter_direction));
     pdf = glm::dot(uvw.w(), scattered.direction()) / std::numbers::pi;
     attenuation = albedo;
@@ -26,10 +54,12 @@ double Lambertian::scatteringPDF(
     return cos_theta < 0 ? 0 : cos_theta / std::numbers::pi;
 }
 
+MaterialRecord Lambertian::record() const { return makeRecord(MaterialRecord::Type::Lambertian, albedo); }
+
 Metal::Metal(const glm::vec3 &albedo) : albedo(albedo) {}
 
 bool Metal::scatter(
-    const Ray &r_in, const HitRecord &rec, glm::vec3 &attenuation, Ray &scattered, float &pdf) const
+    const Ray &r_in, const HitRecord &rec, glm::vec3 &attenuation, Ray &scattered, float &pdf, Utils::Random::RNG &rng) const
 {
     glm::vec3 reflected = reflect(r_in.direction(), rec.normal);
     scattered = Ray(rec.point, reflected);
@@ -37,8 +67,12 @@ bool Metal::scatter(
     return true;
 }
 
+MaterialRecord Metal::record() const { return makeRecord(MaterialRecord::Type::Metal, albedo); }
+
 DiffuseLight::DiffuseLight(const glm::vec3 &emit) : emit(emit) {}
 
+MaterialRecord DiffuseLight::record() const { return makeRecord(MaterialRecord::Type::DiffuseLight, emit); }
+
 glm::vec3 DiffuseLight::emitted(const HitRecord &rec) const
 {
     if (!rec.frontFace)
@@ -47,7 +81,7 @@ glm::vec3 DiffuseLight::emitted(const HitRecord &rec) const
 }
 
 bool DiffuseLight::scatter(
-    const Ray &r_in, const HitRecord &rec, glm::vec3 &attenuation, Ray &scattered, float &pdf) const
+    const Ray &r_in, const HitRecord &rec, glm::vec3 &attenuation, Ray &scattered, float &pdf, Utils::Random::RNG &rng) const
 {
     return false;
 }
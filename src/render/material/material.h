@@ -1,11 +1,28 @@
 #pragma once
 
+#include <cstdint>
+#include <memory>
 #include <glm/vec3.hpp>
 #include "utils.h"
 #include "geometry/ray.h"
 
 class HitRecord;
 
+// Plain description of a material, enough to recreate it, e.g. when stored in a scene cache.
+struct MaterialRecord
+{
+    enum class Type : uint32_t
+    {
+        None,
+        Lambertian,
+        Metal,
+        DiffuseLight
+    };
+
+    Type type = Type::None;
+    float color[3] = {0, 0, 0}; // Albedo, or emitted radiance for lights
+};
+
 // Abstract base class for material properties and behaviors.
 class Material
 {
@@ -14,7 +31,7 @@ public:
 
     // Determines if a ray is scattered by the material.
     virtual bool scatter(
-        const Ray &r_in, const HitRecord &rec, glm::vec3 &attenuation, Ray &scattered, float &pdf) const
+        const Ray &r_in, const HitRecord &rec, glm::vec3 &attenuation, Ray &scattered, float &pdf, Utils::Random::RNG &rng) const
     {
         return false;
     };
@@ -27,6 +44,11 @@ public:
 
     // Returns emitted color from the material (default is no emission).
     virtual glm::vec3 emitted(const HitRecord &rec) const;
+
+    virtual MaterialRecord record() const { return MaterialRecord(); }
+
+    // Recreates a material from its record, nullptr for Type::None.
+    static std::shared_ptr<Material> fromRecord(const MaterialRecord &record);
 };
 
 // Lambertian material for diffuse surfaces.
@@ -36,11 +58,13 @@ public:
     explicit Lambertian(const glm::vec3 &albedo);
 
     bool scatter(
-        const Ray &r_in, const HitRecord &rec, glm::vec3 &attenuation, Ray &scattered, float &pdf) const override;
+        const Ray &r_in, const HitRecord &rec, glm::vec3 &attenuation, Ray &scattered, float &pdf, Utils::Random::RNG &rng) const override;
 
     double scatteringPDF(
         const Ray &r_in, const HitRecord &rec, const Ray &scattered) const override;
 
+    MaterialRecord record() const override;
+
 private:
     glm::vec3 albedo; // Reflectance color
 };
@@ -51,7 +75,9 @@ class Metal : public Material
 public:
     explicit Metal(const glm::vec3 &albedo);
 
-    bool scatter(const Ray &r_in, const HitRecord &rec, glm::vec3 &attenuation, Ray &scattered, float &pdf) const override;
+    bool scatter(const Ray &r_in, const HitRecord &rec, glm::vec3 &attenuation, Ray &scattered, float &pdf, Utils::Random::RNG &rng) const override;
+
+    MaterialRecord record() const override;
 
 private:
     glm::vec3 albedo;
@@ -65,7 +91,9 @@ public:
 
     glm::vec3 emitted(const HitRecord &rec) const override;
 
-    bool scatter(const Ray &r_in, const HitRecord &rec, glm::vec3 &attenuation, Ray &scattered, float &pdf) const override;
+    bool scatter(const Ray &r_in, const HitRecord &rec, glm::vec3 &attenuation, Ray &scattered, float &pdf, Utils::Random::RNG &rng) const override;
+
+    MaterialRecord record() const override;
 
 private:
     glm::vec3 emit;
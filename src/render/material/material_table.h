@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "material.h"
+
+// Materials of one scene. Primitives and hit records refer to them by their 32-bit index, so recording a
+// hit copies no reference count. The table owns the materials; copies of a table share them.
+class MaterialTable
+{
+public:
+    // Adds a material and returns its index.
+    uint32_t add(std::shared_ptr<Material> material)
+    {
+        materials.push_back(std::move(material));
+        return static_cast<uint32_t>(materials.size() - 1);
+    }
+
+    const Material &operator[](uint32_t index) const { return *materials[index]; }
+
+    // The material at index, nullptr for a slot added without one.
+    const std::shared_ptr<Material> &get(uint32_t index) const { return materials[index]; }
+
+    size_t size() const { return materials.size(); }
+
+private:
+    std::vector<std::shared_ptr<Material>> materials;
+};
@@ -0,0 +1,171 @@
+#include "thread_pool.h"
+#include "stats/profiler.h"
+
+namespace
+{
+    // Identifies the pool and deque owned by the current thread (nullptr for threads outside any pool).
+    thread_local const ThreadPool *currentPool = nullptr;
+    thread_local size_t currentQueue = 0;
+
+    // Numbers pools in creation order, so the profiler can tell apart workers of e.g. the loading and render pools.
+    std::atomic<unsigned int> poolCounter{0};
+}
+
+ThreadPool::ThreadPool(unsigned int threadCount) : poolId(poolCounter++)
+{
+    size_t workerCount = threadCount > 1 ? threadCount - 1 : 0;
+    for (size_t i = 0; i < workerCount; i++)
+        queues.push_back(std::make_unique<WorkQueue>());
+
+    workers.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; i++)
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &worker : workers)
+        worker.join();
+}
+
+unsigned int ThreadPool::threadCount() const
+{
+    return static_cast<unsigned int>(workers.size()) + 1;
+}
+
+unsigned int ThreadPool::defaultThreadCount()
+{
+    unsigned int count = std::thread::hardware_concurrency();
+    return count == 0 ? 1 : count;
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)> &body)
+{
+    TaskGroup group(*this);
+    for (size_t i = 0; i < count; i++)
+        group.run([&body, i]() { body(i); });
+    group.wait();
+}
+
+void ThreadPool::push(Task task)
+{
+    if (queues.empty())
+    {
+        // No workers, the waiting thread runs everything itself.
+        task();
+        return;
+    }
+
+    // Counted before the task becomes visible, a thief taking it right away must not decrement first
+    pendingTasks++;
+    size_t queueIndex = (currentPool == this) ? currentQueue : nextQueue++ % queues.size();
+    {
+        std::lock_guard lock(queues[queueIndex]->mutex);
+        queues[queueIndex]->tasks.push_back(std::move(task));
+    }
+    {
+        // Taking the lock orders this wake-up after a worker's predicate check, so it cannot be lost.
+        std::lock_guard lock(sleepMutex);
+    }
+    wake.notify_one();
+}
+
+bool ThreadPool::popLocal(size_t queueIndex, Task &task)
+{
+    auto &queue = *queues[queueIndex];
+    std::lock_guard lock(queue.mutex);
+    if (queue.tasks.empty())
+        return false;
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(size_t thiefIndex, Task &task)
+{
+    for (size_t offset = 1; offset <= queues.size(); offset++)
+    {
+        auto &queue = *queues[(thiefIndex + offset) % queues.size()];
+        std::lock_guard lock(queue.mutex);
+        if (queue.tasks.empty())
+            continue;
+        // Oldest tasks are stolen first, they tend to be the largest pieces of remaining work.
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+bool ThreadPool::tryRunOne()
+{
+    if (queues.empty())
+        return false;
+
+    Task task;
+    bool found = (currentPool == this) ? (popLocal(currentQueue, task) || steal(currentQueue, task))
+                                       : steal(nextQueue++ % queues.size(), task);
+    if (!found)
+        return false;
+
+    pendingTasks--;
+    task();
+    return true;
+}
+
+void ThreadPool::notifyAll()
+{
+    {
+        std::lock_guard lock(sleepMutex);
+    }
+    wake.notify_all();
+}
+
+void ThreadPool::workerLoop(size_t index)
+{
+    currentPool = this;
+    currentQueue = index;
+    Profiler::setThreadName("pool " + std::to_string(poolId) + " worker " + std::to_string(index));
+
+    while (true)
+    {
+        if (tryRunOne())
+            continue;
+
+        std::unique_lock lock(sleepMutex);
+        wake.wait(lock, [this]() { return stopping || pendingTasks.load() > 0; });
+        if (stopping && pendingTasks.load() == 0)
+            return;
+    }
+}
+
+void TaskGroup::run(ThreadPool::Task task)
+{
+    outstanding++;
+    pool.push([this, task = std::move(task)]()
+    {
+        task();
+        // The group may be destroyed as soon as its last task is counted, so only the pool is touched after that
+        ThreadPool &owner = pool;
+        if (--outstanding == 0)
+            owner.notifyAll();
+    });
+}
+
+void TaskGroup::wait()
+{
+    while (outstanding.load() > 0)
+    {
+        if (pool.tryRunOne())
+            continue;
+
+        // Nothing left to take: sleep until the group's last task finishes or more work is queued
+        std::unique_lock lock(pool.sleepMutex);
+        pool.wake.wait(lock, [this]() { return outstanding.load() == 0 || pool.pendingTasks.load() > 0; });
+    }
+}
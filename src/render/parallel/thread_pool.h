@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent pool of worker threads with one task deque per worker.
+// Workers pop their own newest task first and steal the oldest task from other workers when idle,
+// so uneven tasks (e.g. tiles covering the light) do not leave threads waiting.
+class ThreadPool
+{
+public:
+    using Task = std::function<void()>;
+
+    // Creates a pool running threadCount threads in total, the thread waiting on the work counts as one.
+    explicit ThreadPool(unsigned int threadCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    unsigned int threadCount() const;
+
+    // Runs body(i) for every i in [0, count) as separate tasks and blocks until all of them have finished.
+    void parallelFor(size_t count, const std::function<void(size_t)> &body);
+
+    // Number of hardware threads, falling back to 1 when it cannot be determined.
+    static unsigned int defaultThreadCount();
+
+private:
+    friend class TaskGroup;
+
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    // Queues a task on the calling worker's deque, or spreads it across workers for outside threads.
+    void push(Task task);
+
+    // Runs one queued task on the calling thread if any is available.
+    bool tryRunOne();
+
+    // Wakes every sleeping thread, workers and threads waiting on a TaskGroup alike.
+    void notifyAll();
+
+    bool popLocal(size_t queueIndex, Task &task);
+    bool steal(size_t thiefIndex, Task &task);
+    void workerLoop(size_t index);
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<size_t> pendingTasks{0};
+    std::atomic<size_t> nextQueue{0};
+    unsigned int poolId; // Creation order, only used to name worker threads
+    bool stopping = false;
+};
+
+// Set of tasks submitted to a pool that can be waited on together.
+// Waiting threads execute queued tasks while there are any, so groups may be nested inside tasks, and
+// sleep on the pool's condition variable once nothing is left to take.
+class TaskGroup
+{
+public:
+    explicit TaskGroup(ThreadPool &pool) : pool(pool) {}
+    ~TaskGroup() { wait(); }
+
+    TaskGroup(const TaskGroup &) = delete;
+    TaskGroup &operator=(const TaskGroup &) = delete;
+
+    void run(ThreadPool::Task task);
+
+    // Blocks until every task run through this group has finished.
+    void wait();
+
+private:
+    ThreadPool &pool;
+    std::atomic<size_t> outstanding{0};
+};
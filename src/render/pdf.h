@@ -1,51 +1,49 @@
+#pragma once
+
 #include "camera/onb.h"
+#include "stats/ray_stats.h"
 
-class PDF
-{
-public:
-    virtual ~PDF() = default;
+// Sampling distributions over directions. They are plain value types without a common base class: each
+// provides value(direction) and generate(rng), and MixturePDF combines two of them by value. The integrator
+// builds them on the stack at every bounce, so sampling a path allocates nothing and makes no virtual calls.
 
-    virtual double value(const glm::vec3 &direction) const = 0;
-    virtual glm::vec3 generate() const = 0;
-};
-
-class SpherePDF : public PDF
+class SpherePDF
 {
 public:
     SpherePDF() = default;
 
-    double value(const glm::vec3 &direction) const override
+    double value(const glm::vec3 &direction) const
     {
         return 1 / (4 * std::numbers::pi);
     }
 
-    glm::vec3 generate() const override
+    glm::vec3 generate(Utils::Random::RNG &rng) const
     {
-        return Utils::Sampling::sampleUnitSphere();
+        return Utils::Sampling::sampleUnitSphere(rng);
     }
 };
 
-class CosinePDF : public PDF
+class CosinePDF
 {
 public:
     CosinePDF(const glm::vec3 &w) : uvw(w) {}
 
-    double value(const glm::vec3 &direction) const override
+    double value(const glm::vec3 &direction) const
     {
         auto cosine_theta = glm::dot(glm::normalize(direction), uvw.w());
         return std::fmax(0, cosine_theta / std::numbers::pi);
     }
 
-    glm::vec3 generate() const override
+    glm::vec3 generate(Utils::Random::RNG &rng) const
     {
-        return uvw.transform(Utils::Random::randomCosineDirection());
+        return uvw.transform(Utils::Random::randomCosineDirection(rng));
     }
 
 private:
     ONB uvw;
 };
 
-class HittablePDF : public PDF
+class HittablePDF
 {
 public:
     HittablePDF(const Hittable &objects, const glm::vec3 &origin)
@@ -53,14 +51,15 @@ public:
     {
     }
 
-    double value(const glm::vec3 &direction) const override
+    double value(const glm::vec3 &direction) const
     {
+        LUMI_STAT(lightSampleRays, 1);
         return objects.pdfValue(origin, direction);
     }
 
-    glm::vec3 generate() const override
+    glm::vec3 generate(Utils::Random::RNG &rng) const
     {
-        return objects.random(origin);
+        return objects.random(origin, rng);
     }
 
 private:
@@ -68,28 +67,27 @@ private:
     glm::vec3 origin;
 };
 
-class MixturePDF : public PDF
+// Picks either distribution with equal probability.
+template <typename First, typename Second>
+class MixturePDF
 {
 public:
-    MixturePDF(std::shared_ptr<PDF> p0, std::shared_ptr<PDF> p1)
-    {
-        p[0] = p0;
-        p[1] = p1;
-    }
+    MixturePDF(const First &p0, const Second &p1) : p0(p0), p1(p1) {}
 
-    double value(const glm::vec3 &direction) const override
+    double value(const glm::vec3 &direction) const
     {
-        return 0.5 * p[0]->value(direction) + 0.5 * p[1]->value(direction);
+        return 0.5 * p0.value(direction) + 0.5 * p1.value(direction);
     }
 
-    glm::vec3 generate() const override
+    glm::vec3 generate(Utils::Random::RNG &rng) const
     {
-        if (Utils::Random::randomDouble() < 0.5)
-            return p[0]->generate();
+        if (rng.nextFloat() < 0.5f)
+            return p0.generate(rng);
         else
-            return p[1]->generate();
+            return p1.generate(rng);
     }
 
 private:
-    std::array<std::shared_ptr<PDF>, 2> p;
+    First p0;
+    Second p1;
 };
\ No newline at end of file
@@ -11,6 +11,9 @@
 #include "geometry/objects/sphere.h"
 #include "geometry/ray.h"
 #include "camera/camera.h"
+#include "stats/ray_stats.h"
+#include "stats/traversal_heatmap.h"
+#include "stats/profiler.h"
 #include <chrono>
 #include <iostream>
 
@@ -21,6 +24,7 @@ public:
     // Updates a texture with image data.
     void updateTexture(unsigned int texture, const std::vector<glm::vec3> &image, const int &WIDTH, const int &HEIGHT)
     {
+        LUMI_PROFILE_SCOPE("texture upload");
         glBindTexture(GL_TEXTURE_2D, texture);
         glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, WIDTH, HEIGHT, GL_RGB, GL_FLOAT, image.data());
     }
@@ -32,7 +36,17 @@ public:
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     }
 
+    // Blends a false color traversal cost heatmap over the image.
+    void overlayHeatmap(std::vector<glm::vec3> &image, const std::vector<PixelCost> &costs, const std::vector<int> &costSamples, HeatmapSource source)
+    {
+        std::vector<glm::vec3> heat = heatmapColors(heatmapValues(costs, costSamples, source));
+        for (size_t i = 0; i < image.size(); ++i)
+            image[i] = glm::mix(image[i], heat[i], 0.65f);
+    }
+
     // Main rendering loop which handles camera rendering, image updates, and UI rendering.
+    // Each stage is a profiler scope, so a trace shows how they overlap with the render workers.
+    // H cycles a traversal cost overlay through primary ray nodes, primary primitives, path nodes and path primitives.
     void renderLoop(GLFWwindow *window,
                     const Shader &shader,
                     const unsigned int &VAO,
@@ -50,11 +64,27 @@ public:
         double totalRenderTime = 0.0;
         int numRuns = 0;
 
+        // Costs are only gathered while the overlay is shown, averaged over the samples taken since
+        int heatmapMode = 0; // 0 = off, otherwise HeatmapSource + 1
+        bool heatmapKeyDown = false;
+        std::vector<PixelCost> costs;
+        std::vector<int> costSamples;
+
         while (!glfwWindowShouldClose(window))
         {
+            bool keyDown = glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS;
+            if (keyDown && !heatmapKeyDown && Stats::enabled)
+            {
+                heatmapMode = (heatmapMode + 1) % 5;
+                costs.assign(heatmapMode ? IMAGE_SIZE : 0, PixelCost());
+                costSamples.assign(heatmapMode ? IMAGE_SIZE : 0, 0);
+                std::cout << "Heatmap: " << (heatmapMode ? heatmapSourceName(static_cast<HeatmapSource>(heatmapMode - 1)) : "off") << std::endl;
+            }
+            heatmapKeyDown = keyDown;
+
             auto start = std::chrono::high_resolution_clock::now();
 
-            camera.render(world, accumulationBuffer, sampleCount);
+            camera.render(world, accumulationBuffer, sampleCount, heatmapMode ? &costs : nullptr);
 
             auto end = std::chrono::high_resolution_clock::now();
             std::chrono::duration<double> elapsed = end - start;
@@ -64,23 +94,45 @@ public:
             std::cout << "Current render time: " << elapsed.count() << " seconds, "
                       << "Average render time: " << averageRenderTime << " seconds, "
                       << "Number of runs: " << numRuns << std::endl;
+            if (Stats::enabled)
+            {
+                RayStats stats = Stats::collect();
+                std::cout << "  " << stats.tracedRays() / elapsed.count() / 1e6 << " Mrays/s, "
+                          << stats.nodesPerRay() << " nodes/ray, "
+                          << stats.primitiveTestsPerRay() << " primitive tests/ray, "
+                          << stats.meanPathLength() << " mean path length (longest " << stats.longestPath << ")" << std::endl;
+            }
 
-            for (int i = 0; i < IMAGE_SIZE; ++i)
             {
-                currentImage[i] = accumulationBuffer[i] / static_cast<float>(sampleCount[i]);
-                currentImage[i] = Utils::Color::linearToGamma(currentImage[i]);
+                LUMI_PROFILE_SCOPE("tone map");
+                for (int i = 0; i < IMAGE_SIZE; ++i)
+                {
+                    currentImage[i] = accumulationBuffer[i] / static_cast<float>(sampleCount[i]);
+                    currentImage[i] = Utils::Color::linearToGamma(currentImage[i]);
+                }
+            }
+            if (heatmapMode)
+            {
+                LUMI_PROFILE_SCOPE("heatmap overlay");
+                for (auto &count : costSamples)
+                    count += camera.samplesPerFrame();
+                overlayHeatmap(currentImage, costs, costSamples, static_cast<HeatmapSource>(heatmapMode - 1));
             }
             clearFrame(clearColor);
             updateTexture(texture, currentImage, camera.imageWidth, camera.imageHeight);
 
-            shader.use();
-            glBindVertexArray(VAO);
-            glBindTexture(GL_TEXTURE_2D, texture);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
+            {
+                // Swapping waits for vsync, so this also shows how long each frame sits idle
+                LUMI_PROFILE_SCOPE("draw and UI");
+                shader.use();
+                glBindVertexArray(VAO);
+                glBindTexture(GL_TEXTURE_2D, texture);
+                glDrawArrays(GL_TRIANGLES, 0, 6);
 
-            // renderUI();
-            glfwSwapBuffers(window);
-            glfwPollEvents();
+                // renderUI();
+                glfwSwapBuffers(window);
+                glfwPollEvents();
+            }
         }
     }
 };
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include "profiler.h"
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    struct Event
+    {
+        const char *name;
+        uint64_t start;
+        uint64_t end;
+    };
+
+    // Events kept per thread, older ones are overwritten
+    const size_t RING_CAPACITY = size_t(1) << 16;
+
+    struct ThreadBuffer
+    {
+        std::vector<Event> events = std::vector<Event>(RING_CAPACITY);
+        uint64_t written = 0; // Events recorded so far, the next one goes to written % RING_CAPACITY
+        std::string name;
+        int id = 0;
+    };
+
+    std::mutex registryMutex;
+    std::deque<ThreadBuffer> &buffers()
+    {
+        static std::deque<ThreadBuffer> registry;
+        return registry;
+    }
+
+    thread_local ThreadBuffer *threadBuffer = nullptr;
+
+    ThreadBuffer &localBuffer()
+    {
+        if (!threadBuffer)
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            auto &registry = buffers();
+            threadBuffer = &registry.emplace_back();
+            threadBuffer->id = static_cast<int>(registry.size());
+            if (threadBuffer->name.empty())
+                threadBuffer->name = "thread " + std::to_string(threadBuffer->id);
+        }
+        return *threadBuffer;
+    }
+
+    std::string escaped(const std::string &text)
+    {
+        std::string result;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                result += '\\';
+            result += c;
+        }
+        return result;
+    }
+}
+
+namespace Profiler
+{
+    void setEnabled(bool enable)
+    {
+        active.store(enable, std::memory_order_relaxed);
+    }
+
+    void record(const char *name, uint64_t start, uint64_t end)
+    {
+        ThreadBuffer &buffer = localBuffer();
+        buffer.events[buffer.written % RING_CAPACITY] = {name, start, end};
+        buffer.written++;
+    }
+
+    void setThreadName(const std::string &name)
+    {
+        // Registering allocates the ring, only do it for threads that will be profiled
+        if (!enabled() && !threadBuffer)
+            return;
+        ThreadBuffer &buffer = localBuffer();
+        std::lock_guard<std::mutex> lock(registryMutex);
+        buffer.name = name;
+    }
+
+    bool writeChromeTrace(const std::string &path)
+    {
+        std::ofstream file(path);
+        if (!file)
+        {
+            std::cerr << "Cannot open " << path << " for writing" << std::endl;
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(registryMutex);
+        uint64_t origin = UINT64_MAX;
+        for (const auto &buffer : buffers())
+        {
+            uint64_t first = buffer.written > RING_CAPACITY ? buffer.written - RING_CAPACITY : 0;
+            for (uint64_t i = first; i < buffer.written; i++)
+                origin = std::min(origin, buffer.events[i % RING_CAPACITY].start);
+        }
+
+        // Complete ("X") events with microsecond timestamps relative to the first event
+        file << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+        bool first = true;
+        size_t eventCount = 0;
+        for (const auto &buffer : buffers())
+        {
+            file << (first ? "\n" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer.id
+                 << ", \"args\": {\"name\": \"" << escaped(buffer.name) << "\"}}";
+            first = false;
+
+            uint64_t oldest = buffer.written > RING_CAPACITY ? buffer.written - RING_CAPACITY : 0;
+            for (uint64_t i = oldest; i < buffer.written; i++)
+            {
+                const Event &event = buffer.events[i % RING_CAPACITY];
+                file << ",\n{\"name\": \"" << escaped(event.name) << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer.id
+                     << ", \"ts\": " << (event.start - origin) / 1000.0 << ", \"dur\": " << (event.end - event.start) / 1000.0 << "}";
+                eventCount++;
+            }
+        }
+        file << "\n]}\n";
+        std::cerr << "Wrote " << eventCount << " profiler events to " << path << std::endl;
+        return static_cast<bool>(file);
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Scoped timers for the hot paths, off by default and switched on at runtime. Every thread records into its
+// own ring buffer, so recording takes no lock and a long session keeps its most recent events. The events
+// of all threads can be written as Chrome trace-event JSON, viewable in Perfetto or chrome://tracing.
+namespace Profiler
+{
+    inline std::atomic<bool> active{false};
+
+    inline bool enabled() { return active.load(std::memory_order_relaxed); }
+    void setEnabled(bool enable);
+
+    // Nanoseconds on the profiler's clock.
+    inline uint64_t now()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::steady_clock::now().time_since_epoch())
+                                         .count());
+    }
+
+    // Records a finished event on the calling thread. name must outlive the profiler, e.g. a string literal.
+    void record(const char *name, uint64_t start, uint64_t end);
+
+    // Name shown for the calling thread's track in the trace.
+    void setThreadName(const std::string &name);
+
+    // Writes the recorded events of every thread, which must not be recording at the same time
+    // (e.g. call it after rendering finished). Prints the reason and returns false on failure.
+    bool writeChromeTrace(const std::string &path);
+
+    // Times the enclosing scope while the profiler is enabled.
+    class Scope
+    {
+    public:
+        explicit Scope(const char *name) : name(enabled() ? name : nullptr), start(this->name ? now() : 0) {}
+        ~Scope()
+        {
+            if (name)
+                record(name, start, now());
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        const char *name;
+        uint64_t start;
+    };
+}
+
+#define LUMI_PROFILE_CONCAT_INNER(a, b) a##b
+#define LUMI_PROFILE_CONCAT(a, b) LUMI_PROFILE_CONCAT_INNER(a, b)
+#define LUMI_PROFILE_SCOPE(name) Profiler::Scope LUMI_PROFILE_CONCAT(profileScope, __LINE__)(name)
@@ -0,0 +1,72 @@
+#include "ray_stats.h"
+#include <algorithm>
+#include <deque>
+#include <mutex>
+
+namespace
+{
+    // Own cache lines per thread, so counting never contends
+    struct alignas(64) ThreadBlock
+    {
+        RayStats stats;
+    };
+
+    std::mutex registryMutex;
+    std::deque<ThreadBlock> &blocks()
+    {
+        // Blocks are never freed, a thread may exit before its counts are collected
+        static std::deque<ThreadBlock> registry;
+        return registry;
+    }
+}
+
+RayStats &RayStats::operator+=(const RayStats &other)
+{
+    primaryRays += other.primaryRays;
+    bounceRays += other.bounceRays;
+    lightSampleRays += other.lightSampleRays;
+    nodesVisited += other.nodesVisited;
+    aabbTests += other.aabbTests;
+    primitiveTests += other.primitiveTests;
+    longestPath = std::max(longestPath, other.longestPath);
+    for (int i = 0; i < pathLengthBins; i++)
+        pathLengths[i] += other.pathLengths[i];
+    return *this;
+}
+
+double RayStats::nodesPerRay() const
+{
+    return tracedRays() ? static_cast<double>(nodesVisited) / static_cast<double>(tracedRays()) : 0.0;
+}
+
+double RayStats::primitiveTestsPerRay() const
+{
+    return tracedRays() ? static_cast<double>(primitiveTests) / static_cast<double>(tracedRays()) : 0.0;
+}
+
+double RayStats::meanPathLength() const
+{
+    return primaryRays ? static_cast<double>(primaryRays + bounceRays) / static_cast<double>(primaryRays) : 0.0;
+}
+
+namespace Stats
+{
+    RayStats *registerThread()
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        threadStats = &blocks().emplace_back().stats;
+        return threadStats;
+    }
+
+    RayStats collect()
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        RayStats total;
+        for (auto &block : blocks())
+        {
+            total += block.stats;
+            block.stats = RayStats();
+        }
+        return total;
+    }
+}
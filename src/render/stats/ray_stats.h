@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+
+// Counts of the work done while rendering, to tell whether a slowdown comes from the scene, the BVH
+// or the integrator. Every thread increments its own cache line aligned block without atomics; collect()
+// sums the blocks once a frame, while no thread is rendering.
+//
+// Counting is compiled in with LUMI_ENABLE_STATS=1 (the LUMI_STATS CMake option). Otherwise LUMI_STAT
+// expands to nothing and collect() returns zeros.
+struct RayStats
+{
+    uint64_t primaryRays = 0;     // Camera rays, one per path
+    uint64_t bounceRays = 0;      // Rays traced from a surface to continue a path
+    uint64_t lightSampleRays = 0; // Rays cast against lights to evaluate their sampling PDF
+    uint64_t nodesVisited = 0;    // BVH nodes (binary or wide) whose box the ray entered or that were popped
+    uint64_t aabbTests = 0;       // Ray/box slab tests, one per child box of a wide node
+    uint64_t primitiveTests = 0;  // Ray tests against spheres, quads and triangles
+    uint64_t longestPath = 0;     // Most segments of a single path
+
+    // Path length histogram: pathLengths[i] counts the paths of i + 1 segments, the last bin longer ones too.
+    static constexpr int pathLengthBins = 32;
+    uint64_t pathLengths[pathLengthBins] = {};
+
+    RayStats &operator+=(const RayStats &other);
+
+    uint64_t tracedRays() const { return primaryRays + bounceRays + lightSampleRays; }
+
+    // Averages per traced ray and per path, zero when nothing was traced.
+    double nodesPerRay() const;
+    double primitiveTestsPerRay() const;
+    double meanPathLength() const;
+};
+
+namespace Stats
+{
+#if LUMI_ENABLE_STATS
+    constexpr bool enabled = true;
+#else
+    constexpr bool enabled = false;
+#endif
+
+    // Registers a block for the calling thread, used by local() on a thread's first count.
+    RayStats *registerThread();
+
+    inline thread_local RayStats *threadStats = nullptr;
+
+    // Counters of the calling thread.
+    inline RayStats &local()
+    {
+        RayStats *stats = threadStats;
+        return stats ? *stats : *registerThread();
+    }
+
+    // Sums the counters of every thread and resets them. Must not run while other threads are counting,
+    // e.g. call it after Camera::render returned.
+    RayStats collect();
+}
+
+#if LUMI_ENABLE_STATS
+#define LUMI_STAT(counter, amount) (Stats::local().counter += (amount))
+#define LUMI_STAT_MAX(counter, value)              \
+    do                                             \
+    {                                              \
+        RayStats &lumiStats = Stats::local();      \
+        if (lumiStats.counter < (value))           \
+            lumiStats.counter = (value);           \
+    } while (0)
+#else
+#define LUMI_STAT(counter, amount) ((void)0)
+#define LUMI_STAT_MAX(counter, value) ((void)0)
+#endif
@@ -0,0 +1,81 @@
+#include "traversal_heatmap.h"
+#include <algorithm>
+#include <array>
+
+const char *heatmapSourceName(HeatmapSource source)
+{
+    switch (source)
+    {
+    case HeatmapSource::PrimaryNodes:
+        return "primary-nodes";
+    case HeatmapSource::PrimaryPrimitives:
+        return "primary-primitives";
+    case HeatmapSource::PathNodes:
+        return "path-nodes";
+    case HeatmapSource::PathPrimitives:
+        return "path-primitives";
+    }
+    return "";
+}
+
+bool parseHeatmapSource(const std::string &name, HeatmapSource &source)
+{
+    for (auto candidate : {HeatmapSource::PrimaryNodes, HeatmapSource::PrimaryPrimitives, HeatmapSource::PathNodes, HeatmapSource::PathPrimitives})
+    {
+        if (name == heatmapSourceName(candidate))
+        {
+            source = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<float> heatmapValues(const std::vector<PixelCost> &costs, const std::vector<int> &sampleCount, HeatmapSource source)
+{
+    std::vector<float> values(costs.size(), 0.0f);
+    for (size_t i = 0; i < costs.size(); i++)
+    {
+        if (sampleCount[i] == 0)
+            continue;
+        const PixelCost &cost = costs[i];
+        float total = source == HeatmapSource::PrimaryNodes        ? cost.primaryNodes
+                      : source == HeatmapSource::PrimaryPrimitives ? cost.primaryPrimitives
+                      : source == HeatmapSource::PathNodes         ? cost.pathNodes
+                                                                   : cost.pathPrimitives;
+        values[i] = total / static_cast<float>(sampleCount[i]);
+    }
+    return values;
+}
+
+std::vector<glm::vec3> heatmapColors(const std::vector<float> &values, float *scale)
+{
+    std::vector<float> sorted(values);
+    float top = 0.0f;
+    if (!sorted.empty())
+    {
+        auto percentile = sorted.begin() + static_cast<std::ptrdiff_t>(0.99 * static_cast<double>(sorted.size() - 1));
+        std::nth_element(sorted.begin(), percentile, sorted.end());
+        top = *percentile;
+    }
+    if (top <= 0.0f)
+        top = 1.0f;
+    if (scale)
+        *scale = top;
+
+    static const std::array<glm::vec3, 5> stops = {
+        glm::vec3(0.0f, 0.0f, 0.5f),
+        glm::vec3(0.0f, 0.6f, 1.0f),
+        glm::vec3(0.1f, 0.9f, 0.2f),
+        glm::vec3(1.0f, 0.9f, 0.0f),
+        glm::vec3(0.9f, 0.0f, 0.0f)};
+
+    std::vector<glm::vec3> colors(values.size());
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        float t = std::clamp(values[i] / top, 0.0f, 1.0f) * static_cast<float>(stops.size() - 1);
+        size_t stop = std::min(static_cast<size_t>(t), stops.size() - 2);
+        colors[i] = glm::mix(stops[stop], stops[stop + 1], t - static_cast<float>(stop));
+    }
+    return colors;
+}
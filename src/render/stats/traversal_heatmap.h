@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Traversal work of one pixel, summed over its samples. Filled by Camera::render from the ray stats
+// counters, so it stays zero in builds with LUMI_ENABLE_STATS=0.
+struct PixelCost
+{
+    float primaryNodes = 0.0f;      // BVH nodes visited by the camera ray
+    float primaryPrimitives = 0.0f; // Primitives tested by the camera ray
+    float pathNodes = 0.0f;         // Nodes visited by the whole path, light sampling included
+    float pathPrimitives = 0.0f;
+};
+
+// Which cost a heatmap shows.
+enum class HeatmapSource
+{
+    PrimaryNodes,
+    PrimaryPrimitives,
+    PathNodes,
+    PathPrimitives
+};
+
+const char *heatmapSourceName(HeatmapSource source);
+
+// Parses "primary-nodes", "primary-primitives", "path-nodes" or "path-primitives".
+bool parseHeatmapSource(const std::string &name, HeatmapSource &source);
+
+// Mean cost per sample of every pixel.
+std::vector<float> heatmapValues(const std::vector<PixelCost> &costs, const std::vector<int> &sampleCount, HeatmapSource source);
+
+// Maps values to false colors from blue (cheap) through green and yellow to red, normalised to the 99th
+// percentile so a few extreme pixels do not wash out the rest. Returns the value shown as full red in scale.
+std::vector<glm::vec3> heatmapColors(const std::vector<float> &values, float *scale = nullptr);
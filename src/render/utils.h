@@ -1,6 +1,6 @@
 #pragma once
 
-#include <random>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <glm/gtx/norm.hpp>
 #include <numbers>
@@ -11,19 +11,75 @@ namespace Utils
 {
     namespace Random
     {
+        // Counter-based generator: every draw is a hash of (key, bounce, dimension), so the numbers
+        // used by a sample only depend on its pixel and sample index, never on which thread renders it.
+        // The whole state is 16 bytes and is passed by reference through the sampling calls.
+        class RNG
+        {
+        public:
+            RNG() : RNG(0, 0) {}
+            RNG(uint32_t pixel, uint32_t sampleIndex)
+                : key(mix((static_cast<uint64_t>(pixel) << 32) | sampleIndex)) {}
+
+            // Moves to the dimensions reserved for a given path vertex.
+            void startBounce(uint32_t bounce)
+            {
+                counter = static_cast<uint64_t>(bounce) << 32;
+            }
+
+            // Next 32 random bits.
+            uint32_t nextUInt()
+            {
+                return static_cast<uint32_t>(mix(key + counter++ * 0x9E3779B97F4A7C15ull) >> 32);
+            }
+
+            // Uniform float in [0, 1).
+            float nextFloat()
+            {
+                return static_cast<float>(nextUInt() >> 8) * 0x1.0p-24f;
+            }
+
+            // Uniform double in [0, 1).
+            double nextDouble()
+            {
+                return static_cast<double>(nextUInt()) * 0x1.0p-32;
+            }
+
+            double nextDouble(double min, double max)
+            {
+                return min + (max - min) * nextDouble();
+            }
+
+        private:
+            // SplitMix64 finaliser.
+            static uint64_t mix(uint64_t z)
+            {
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                return z ^ (z >> 31);
+            }
+
+            uint64_t key;
+            uint64_t counter = 0;
+        };
+
+        // Per-thread generator for work outside of sample paths (e.g. scene construction).
+        // Fixed seed, so generated scenes are identical between runs.
+        inline RNG &threadRNG()
+        {
+            thread_local RNG rng;
+            return rng;
+        }
+
         // Generates a random double between 0.0 and 1.0.
         inline double randomDouble()
         {
-            static std::mt19937 generator(std::random_device{}());
-            static std::uniform_real_distribution<> distribution(0.0f, 1.0f);
-            return distribution(generator);
+            return threadRNG().nextDouble();
         }
 
         inline double randomDouble(double min, double max)
         {
-            static std::mt19937 generator(std::random_device{}());
-            std::uniform_real_distribution<> distribution(min, max);
-            return distribution(generator);
+            return threadRNG().nextDouble(min, max);
         }
 
         inline int randomInt(int min, int max)
@@ -31,10 +87,10 @@ namespace Utils
             return int(randomDouble(min, max + 1));
         }
 
-        inline glm::vec3 randomCosineDirection()
+        inline glm::vec3 randomCosineDirection(RNG &rng)
         {
-            auto r1 = randomDouble();
-            auto r2 = randomDouble();
+            auto r1 = rng.nextDouble();
+            auto r2 = rng.nextDouble();
 
             auto phi = 2 * std::numbers::pi * r1;
             auto x = std::cos(phi) * std::sqrt(r2);
@@ -66,17 +122,17 @@ namespace Utils
     namespace Sampling
     {
         // Samples a point within a unit square (0f z component).
-        inline glm::vec3 sampleUnitSquare()
+        inline glm::vec3 sampleUnitSquare(Random::RNG &rng)
         {
-            return glm::vec3(Random::randomDouble() - 0.5f, Random::randomDouble() - 0.5f, 0.0f);
+            return glm::vec3(rng.nextFloat() - 0.5f, rng.nextFloat() - 0.5f, 0.0f);
         }
 
         // Samples a point within a unit sphere.
-        inline glm::vec3 sampleUnitSphere()
+        inline glm::vec3 sampleUnitSphere(Random::RNG &rng)
         {
             while (true)
             {
-                glm::vec3 point(Random::randomDouble(-1.0f, 1.0f), Random::randomDouble(-1.0f, 1.0f), Random::randomDouble(-1.0f, 1.0f));
+                glm::vec3 point(rng.nextDouble(-1.0f, 1.0f), rng.nextDouble(-1.0f, 1.0f), rng.nextDouble(-1.0f, 1.0f));
                 if (glm::length2(point) < 1.0f)
                 {
                     return glm::normalize(point);
@@ -85,9 +141,9 @@ namespace Utils
         }
 
         // Samples a point on the hemisphere oriented by the normal.
-        inline glm::vec3 randomOnHemisphere(const glm::vec3 &normal)
+        inline glm::vec3 randomOnHemisphere(const glm::vec3 &normal, Random::RNG &rng)
         {
-            glm::vec3 onUnitSphere = sampleUnitSphere();
+            glm::vec3 onUnitSphere = sampleUnitSphere(rng);
             return (glm::dot(onUnitSphere, normal) > 0.0f) ? onUnitSphere : -onUnitSphere;
         }
     }